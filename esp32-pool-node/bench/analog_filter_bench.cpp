@@ -0,0 +1,187 @@
+// Host benchmark for the analog probe filter chain (src/analog_filter.cpp).
+//
+// Build and run from esp32-pool-node/:
+//   g++ -O2 -std=c++17 -Isrc bench/analog_filter_bench.cpp src/analog_filter.cpp -o /tmp/filter_bench
+//   /tmp/filter_bench capture.log [more.log ...]
+//
+// Inputs are serial captures from a node built with -DADC_TRACE_DUMP (pio run -e adc_trace);
+// every "ADCTRACE <sensor_id> <rate_hz> <count> v0,v1,..." line is one recorded burst and
+// all other lines are ignored. Without arguments a synthetic burst is generated
+// (DC level + 60 Hz hum + white noise + occasional spikes) so the chain can still be timed.
+//
+// Output uses the same "BENCH {json}" lines as the on-target payload benchmarks.
+// "spread" is the standard deviation of the per-burst results for one sensor, i.e. how
+// repeatable the reading is; it is reported for the full chain and for a plain mean.
+
+#include "analog_filter.h"
+#include "../include/config.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Trace {
+    std::string sensorId;
+    int rateHz;
+    std::vector<uint16_t> samples;
+};
+
+static bool parseTraceLine(const std::string& line, Trace& trace) {
+    size_t start = line.find("ADCTRACE ");
+    if (start == std::string::npos) {
+        return false;
+    }
+
+    std::istringstream in(line.substr(start + 9));
+    size_t count = 0;
+    std::string values;
+    if (!(in >> trace.sensorId >> trace.rateHz >> count >> values)) {
+        return false;
+    }
+
+    trace.samples.clear();
+    std::istringstream list(values);
+    std::string value;
+    while (std::getline(list, value, ',')) {
+        trace.samples.push_back((uint16_t)std::strtoul(value.c_str(), nullptr, 10));
+    }
+    return trace.samples.size() == count;
+}
+
+static std::vector<Trace> loadTraces(int argc, char** argv) {
+    std::vector<Trace> traces;
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i]);
+        if (!file) {
+            fprintf(stderr, "Cannot open %s\n", argv[i]);
+            exit(1);
+        }
+        std::string line;
+        Trace trace;
+        while (std::getline(file, line)) {
+            if (parseTraceLine(line, trace)) {
+                traces.push_back(trace);
+            }
+        }
+    }
+    return traces;
+}
+
+static std::vector<Trace> syntheticTraces(int bursts) {
+    std::vector<Trace> traces;
+    std::mt19937 rng(1234);
+    std::normal_distribution<float> noise(0.0f, 6.0f);
+    std::uniform_int_distribution<int> spike(0, 199);
+
+    for (int b = 0; b < bursts; b++) {
+        Trace trace = {"synthetic", ADC_SAMPLE_RATE_HZ, {}};
+        float phase = b * 0.7f;
+        for (int i = 0; i < ADC_BURST_SAMPLES; i++) {
+            float t = (float)i / ADC_SAMPLE_RATE_HZ;
+            float value = 1850.0f + 25.0f * sinf(2.0f * (float)M_PI * 60.0f * t + phase) + noise(rng);
+            if (spike(rng) == 0) {
+                value += 600.0f;
+            }
+            trace.samples.push_back((uint16_t)std::min(std::max(value, 0.0f), 4095.0f));
+        }
+        traces.push_back(trace);
+    }
+    return traces;
+}
+
+template <typename Body>
+static double timeNs(int iterations, Body body) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        body();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+static void report(const char* name, size_t samples, double nsAvg) {
+    printf("BENCH {\"name\":\"%s\",\"kernel\":\"%s\",\"samples\":%zu,\"taps\":%d,\"decimation\":%d,"
+           "\"ns_avg\":%.0f,\"ns_per_sample\":%.2f}\n",
+           name, AnalogFilterChain::getKernelName(), samples, ADC_FIR_TAPS, ADC_DECIMATION,
+           nsAvg, nsAvg / samples);
+}
+
+static double spread(const std::vector<double>& values) {
+    if (values.size() < 2) {
+        return 0.0;
+    }
+    double mean = 0.0;
+    for (double v : values) mean += v;
+    mean /= values.size();
+    double variance = 0.0;
+    for (double v : values) variance += (v - mean) * (v - mean);
+    return sqrt(variance / (values.size() - 1));
+}
+
+int main(int argc, char** argv) {
+    std::vector<Trace> traces = argc > 1 ? loadTraces(argc, argv) : syntheticTraces(50);
+    if (traces.empty()) {
+        fprintf(stderr, "No ADCTRACE lines found\n");
+        return 1;
+    }
+
+    AnalogFilterChain chain(ADC_FIR_TAPS, ADC_DECIMATION, ADC_TRIM_PERCENT);
+    const int iterations = 200;
+
+    // Timing on the first burst; every stage sees the same input size as on the device
+    const Trace& first = traces.front();
+    size_t count = first.samples.size();
+    std::vector<float> work(count), decimated(chain.decimatedLength(count) + 1), sorted;
+    AnalogFilterResult result;
+
+    chain.convert(first.samples.data(), count, work.data());
+    size_t produced = chain.decimate(work.data(), count, decimated.data());
+
+    report("adc_convert", count, timeNs(iterations, [&]() {
+        chain.convert(first.samples.data(), count, work.data());
+    }));
+    report("adc_fir_decimate", count, timeNs(iterations, [&]() {
+        chain.decimate(work.data(), count, decimated.data());
+    }));
+    report("adc_trimmed_mean", produced, timeNs(iterations, [&]() {
+        sorted.assign(decimated.begin(), decimated.begin() + produced);
+        chain.trimmedMean(sorted.data(), produced, nullptr);
+    }));
+    report("adc_chain", count, timeNs(iterations, [&]() {
+        chain.process(first.samples.data(), count, work.data(), decimated.data(), result);
+    }));
+
+    // Repeatability per sensor: filtered chain vs plain mean of the raw burst
+    std::map<std::string, std::vector<double>> filtered, plain;
+    std::map<std::string, double> noise;
+    for (const Trace& trace : traces) {
+        size_t n = trace.samples.size();
+        std::vector<float> traceWork(n), traceOut(chain.decimatedLength(n) + 1);
+        if (!chain.process(trace.samples.data(), n, traceWork.data(), traceOut.data(), result)) {
+            continue;
+        }
+        double sum = 0.0;
+        for (uint16_t s : trace.samples) sum += s;
+
+        filtered[trace.sensorId].push_back(result.value);
+        plain[trace.sensorId].push_back(sum / n);
+        noise[trace.sensorId] += result.noise;
+    }
+
+    for (const auto& entry : filtered) {
+        const std::string& id = entry.first;
+        size_t bursts = entry.second.size();
+        printf("BENCH {\"name\":\"adc_repeatability\",\"sensor_id\":\"%s\",\"bursts\":%zu,"
+               "\"spread_filtered\":%.3f,\"spread_plain_mean\":%.3f,\"noise_avg\":%.3f}\n",
+               id.c_str(), bursts, spread(entry.second), spread(plain[id]), noise[id] / bursts);
+    }
+
+    return 0;
+}
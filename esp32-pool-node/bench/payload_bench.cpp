@@ -0,0 +1,28 @@
+// Host run of the on-target payload benchmarks (src/benchmark.cpp).
+//
+// Build from esp32-pool-node/ as one command (ArduinoJson is header-only; any v7 copy
+// works, e.g. the one PlatformIO downloaded into .pio/libdeps):
+//   g++ -O2 -std=gnu++17 -DARDUINOJSON_ENABLE_ARDUINO_STRING=1
+//       -Ireplay/shim -Ireplay -Isrc -Iinclude -I<ArduinoJson>/src
+//       bench/payload_bench.cpp src/benchmark.cpp src/payloads.cpp src/sensors.cpp
+//       src/sensor_health.cpp src/sensor_trace.cpp src/trace_format.cpp src/cycle_budget.cpp
+//       src/json_arena.cpp src/reading_buffer.cpp src/series_codec.cpp replay/replay_io.cpp
+//       -o /tmp/payload_bench
+//   /tmp/payload_bench [iterations]
+//
+// Uses the replay shim for the Arduino API, so documents are built by the same code as
+// on the node. Prints the same "BENCH {json}" lines as the benchmark environment with
+// "target":"host"; cycles are nanoseconds (cpu_mhz 1000). Use it to compare payload
+// changes quickly, and pio run -e benchmark for the numbers that matter.
+
+#include <stdlib.h>
+#include "benchmark.h"
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 200;
+    if (iterations <= 0) {
+        return 2;
+    }
+    runPayloadBenchmarks(iterations);
+    return 0;
+}
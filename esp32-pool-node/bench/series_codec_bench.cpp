@@ -0,0 +1,223 @@
+// Host benchmark for the history time-series codec (src/series_codec.cpp).
+//
+// Build and run from esp32-pool-node/:
+//   g++ -O2 -std=c++17 -Isrc bench/series_codec_bench.cpp src/series_codec.cpp -o /tmp/series_bench
+//   /tmp/series_bench [days]
+//
+// Generates a week (or `days`) of 5-minute readings per scenario, splits them into
+// SERIES_BLOCK_SIZE blocks exactly like publishBufferedReadings() and reports, as
+// "BENCH {json}" lines, the bytes per sample for the raw RTC struct, the JSON history
+// payload and both series encodings, plus encode/decode cost. The on-target numbers come
+// from the history_* lines of the benchmark environment (pio run -e benchmark).
+
+#include "series_codec.h"
+#include "../include/config.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// Same fields as BufferedReading in reading_buffer.h
+struct Reading {
+    uint32_t sequence;
+    uint32_t timestampS;
+    int16_t temperatureCentiF;
+    uint16_t batteryMv;
+    uint8_t batteryPercent;
+    uint8_t flags;
+};
+
+static SeriesSample toSample(const Reading& reading) {
+    SeriesSample sample = {};
+    sample.timestampS = reading.timestampS;
+    sample.sequence = reading.sequence;
+    sample.flags = reading.flags;
+    sample.values[SERIES_TEMPERATURE_F] = reading.temperatureCentiF / 100.0f;
+    sample.values[SERIES_BATTERY_VOLTAGE] = reading.batteryMv / 1000.0f;
+    sample.values[SERIES_BATTERY_PERCENT] = reading.batteryPercent;
+    return sample;
+}
+
+// Diurnal water temperature at DS18B20 resolution (0.0625 C), a discharging
+// battery with ADC noise and a float switch that trips now and then.
+// `missedCycles` drops readings and adds wake-up jitter, as when the node was offline.
+static std::vector<Reading> generate(int days, bool missedCycles, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> batteryNoise(0.0f, 3.0f);
+    std::uniform_int_distribution<int> percent(0, 99);
+
+    std::vector<Reading> readings;
+    int samples = days * 86400 / DEFAULT_SLEEP_DURATION_S;
+    uint32_t t = 1000;
+    bool waterOk = true;
+    for (int i = 0; i < samples; i++) {
+        t += DEFAULT_SLEEP_DURATION_S;
+        if (missedCycles) {
+            if (percent(rng) < 15) {
+                continue;
+            }
+            t += percent(rng) % 3;
+        }
+
+        float hours = t / 3600.0f;
+        float celsius = 25.5f + 1.5f * sinf(2.0f * (float)M_PI * (hours - 9.0f) / 24.0f);
+        celsius = roundf(celsius / 0.0625f) * 0.0625f;
+        float fahrenheit = celsius * 9.0f / 5.0f + 32.0f;
+        float volts = 4.1f - 0.4f * i / samples + batteryNoise(rng) / 1000.0f;
+
+        if (percent(rng) == 0) {
+            waterOk = !waterOk;
+        }
+
+        Reading reading = {};
+        reading.sequence = 1000 + (uint32_t)readings.size();
+        reading.timestampS = t;
+        reading.temperatureCentiF = (int16_t)lroundf(fahrenheit * 100.0f);
+        reading.batteryMv = (uint16_t)lroundf(volts * 1000.0f);
+        reading.batteryPercent = (uint8_t)(100 - 60 * i / samples);
+        reading.flags = SERIES_HAS_TEMPERATURE | SERIES_HAS_WATER_LEVEL | SERIES_HAS_BATTERY;
+        if (waterOk) {
+            reading.flags |= SERIES_WATER_OK;
+        }
+        if (percent(rng) == 0) {
+            reading.flags &= ~SERIES_HAS_BATTERY;
+        }
+        readings.push_back(reading);
+    }
+    return readings;
+}
+
+// Payload size of the HISTORY_FORMAT_JSON messages for the same readings
+static size_t jsonBytes(const std::vector<Reading>& readings) {
+    size_t total = 0;
+    char entry[160];
+    for (size_t start = 0; start < readings.size(); start += HISTORY_BATCH_SIZE) {
+        total += snprintf(entry, sizeof(entry), "{\"device_id\":\"%s\",\"now_s\":%u,\"readings\":[]}",
+                          DEVICE_ID, readings[start].timestampS);
+        for (size_t i = start; i < readings.size() && i < start + HISTORY_BATCH_SIZE; i++) {
+            const Reading& r = readings[i];
+            int length = snprintf(entry, sizeof(entry), "{\"seq\":%u,\"t\":%u", r.sequence, r.timestampS);
+            if (r.flags & SERIES_HAS_TEMPERATURE) {
+                length += snprintf(entry + length, sizeof(entry) - length, ",\"temperature_f\":%g", r.temperatureCentiF / 100.0f);
+            }
+            if (r.flags & SERIES_HAS_WATER_LEVEL) {
+                length += snprintf(entry + length, sizeof(entry) - length, ",\"water_level\":%s",
+                                   (r.flags & SERIES_WATER_OK) ? "true" : "false");
+            }
+            if (r.flags & SERIES_HAS_BATTERY) {
+                length += snprintf(entry + length, sizeof(entry) - length, ",\"battery_voltage\":%g,\"battery_percentage\":%u",
+                                   r.batteryMv / 1000.0f, r.batteryPercent);
+            }
+            total += length + 1 + (i > start ? 1 : 0);   // closing brace, separating comma
+        }
+    }
+    return total;
+}
+
+// Encodes all readings into as many blocks as publishBufferedReadings() would send
+static std::vector<std::vector<uint8_t>> encodeBlocks(const std::vector<Reading>& readings, uint8_t encoding) {
+    std::vector<std::vector<uint8_t>> blocks;
+    size_t next = 0;
+    while (next < readings.size()) {
+        std::vector<uint8_t> block(SERIES_BLOCK_SIZE);
+        SeriesEncoder encoder;
+        encoder.begin(block.data(), block.size(), encoding);
+        while (next < readings.size() && encoder.append(toSample(readings[next]))) {
+            next++;
+        }
+        block.resize(encoder.finish(readings[next - 1].timestampS));
+        blocks.push_back(block);
+    }
+    return blocks;
+}
+
+static bool verify(const std::vector<Reading>& readings, const std::vector<std::vector<uint8_t>>& blocks) {
+    size_t index = 0;
+    for (const std::vector<uint8_t>& block : blocks) {
+        SeriesDecoder decoder(block.data(), block.size());
+        SeriesBlockInfo info;
+        SeriesSample sample;
+        if (!decoder.begin(info)) {
+            return false;
+        }
+        while (decoder.next(sample)) {
+            SeriesSample expected = toSample(readings[index++]);
+            if (sample.timestampS != expected.timestampS || sample.sequence != expected.sequence ||
+                sample.flags != expected.flags) {
+                return false;
+            }
+            for (int channel = 0; channel < SERIES_CHANNEL_COUNT; channel++) {
+                bool present = channel == SERIES_TEMPERATURE_F ? (sample.flags & SERIES_HAS_TEMPERATURE)
+                                                               : (sample.flags & SERIES_HAS_BATTERY);
+                if (present && memcmp(&sample.values[channel], &expected.values[channel], sizeof(float)) != 0) {
+                    return false;
+                }
+            }
+        }
+    }
+    return index == readings.size();
+}
+
+template <typename Body>
+static double timeNs(int iterations, Body body) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        body();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+static void runScenario(const char* scenario, const std::vector<Reading>& readings) {
+    const int iterations = 50;
+    size_t count = readings.size();
+    size_t raw = count * sizeof(Reading);
+    size_t json = jsonBytes(readings);
+
+    for (uint8_t encoding : {SERIES_QUANTIZED, SERIES_XOR}) {
+        std::vector<std::vector<uint8_t>> blocks = encodeBlocks(readings, encoding);
+        size_t series = 0;
+        for (const std::vector<uint8_t>& block : blocks) {
+            series += block.size();
+        }
+
+        double encodeNs = timeNs(iterations, [&]() {
+            encodeBlocks(readings, encoding);
+        });
+        double decodeNs = timeNs(iterations, [&]() {
+            for (const std::vector<uint8_t>& block : blocks) {
+                SeriesDecoder decoder(block.data(), block.size());
+                SeriesBlockInfo info;
+                SeriesSample sample;
+                decoder.begin(info);
+                while (decoder.next(sample)) {
+                }
+            }
+        });
+
+        printf("BENCH {\"name\":\"history_series\",\"scenario\":\"%s\",\"encoding\":\"%s\",\"samples\":%zu,"
+               "\"blocks\":%zu,\"raw_bytes_per_sample\":%.2f,\"json_bytes_per_sample\":%.2f,"
+               "\"series_bytes_per_sample\":%.2f,\"ratio_vs_raw\":%.1f,\"ratio_vs_json\":%.1f,"
+               "\"encode_ns_per_sample\":%.1f,\"decode_ns_per_sample\":%.1f,\"lossless\":%s}\n",
+               scenario, encoding == SERIES_XOR ? "xor" : "quantized", count, blocks.size(),
+               (double)raw / count, (double)json / count, (double)series / count,
+               (double)raw / series, (double)json / series,
+               encodeNs / count, decodeNs / count, verify(readings, blocks) ? "true" : "false");
+    }
+}
+
+int main(int argc, char** argv) {
+    int days = argc > 1 ? atoi(argv[1]) : 7;
+    if (days <= 0) {
+        fprintf(stderr, "Usage: %s [days]\n", argv[0]);
+        return 1;
+    }
+
+    runScenario("steady", generate(days, false, 1));
+    runScenario("missed_cycles", generate(days, true, 2));
+    return 0;
+}
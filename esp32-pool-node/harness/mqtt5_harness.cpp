@@ -0,0 +1,561 @@
+// Host harness for the MQTT 5 transport (src/mqtt5_transport.cpp).
+//
+// Build and run from esp32-pool-node/:
+//   g++ -O1 -g -std=c++17 -Iharness/shim -Isrc -Iinclude harness/mqtt5_harness.cpp -o /tmp/mqtt5_harness
+//   /tmp/mqtt5_harness [-v]
+//
+// The transport talks to a scripted in-process broker that decodes every packet
+// it is sent, keeps the broker's view of the topic aliases and answers CONNECT,
+// SUBSCRIBE, PINGREQ and (optionally) QoS1 PUBLISH like mosquitto does. Each case
+// prints "PASS <name>" or "FAIL <name>: <reason>"; the exit code is the failure
+// count. Time is virtual, so the ack timeouts run instantly. -v shows the
+// transport's Serial output.
+//
+// The transport is compiled in with MQTT_PUBLISH_QOS 1 so the in-flight window
+// is exercised whatever config.h currently selects.
+
+#include "config.h"
+#undef MQTT_PUBLISH_QOS
+#define MQTT_PUBLISH_QOS 1
+#include "mqtt5_transport.cpp"
+
+#include <stdarg.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+// Virtual clock and Serial
+static unsigned long virtualMs = 0;
+HardwareSerial Serial;
+
+unsigned long millis() {
+    return virtualMs;
+}
+
+void delay(unsigned long ms) {
+    virtualMs += ms;
+}
+
+int HardwareSerial::printf(const char* format, ...) {
+    if (!verbose) {
+        return 0;
+    }
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n;
+}
+
+size_t HardwareSerial::println(const char* text) {
+    return verbose ? ::printf("%s\n", text) : 0;
+}
+
+// PUBLISH as the broker decoded it
+struct BrokerPublish {
+    std::string topic;        // Resolved through the alias table
+    bool topicSent;           // False when only an alias was on the wire
+    uint16_t alias;
+    uint16_t packetId;
+    uint8_t qos;
+    bool dup;
+    bool retained;
+    std::string payload;
+};
+
+// Scripted MQTT 5 broker behind the Client interface
+class FakeBroker : public Client {
+public:
+    // Script, applied to the next CONNECT
+    uint16_t topicAliasMax = 4;
+    uint16_t receiveMax = MQTT_INFLIGHT_WINDOW;
+    bool sessionPresent = false;
+    // Script, applied immediately
+    bool autoAck = true;
+    uint8_t ackReason = 0x00;
+    int deliverLimit = -1;    // Bytes readable before the rest "arrives"; -1 for all
+    int failWrites = 0;       // Next writes return 0 bytes
+
+    std::vector<BrokerPublish> publishes;
+    std::vector<uint16_t> unacked;
+    std::vector<uint16_t> acksReceived;
+    std::vector<std::string> errors;
+    int connects = 0;
+
+    int connect(const char* /*host*/, uint16_t /*port*/) override {
+        up = true;
+        rx.clear();
+        tx.clear();
+        return 1;
+    }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        if (!up) {
+            return 0;
+        }
+        if (failWrites > 0) {
+            failWrites--;
+            return 0;
+        }
+        tx.insert(tx.end(), buf, buf + size);
+        parsePackets();
+        return size;
+    }
+
+    int available() override {
+        if (!up) {
+            return 0;
+        }
+        return deliverLimit >= 0 && deliverLimit < (int)rx.size() ? deliverLimit : (int)rx.size();
+    }
+
+    int read() override {
+        if (rx.empty() || deliverLimit == 0) {
+            return -1;
+        }
+        if (deliverLimit > 0) {
+            deliverLimit--;
+        }
+        uint8_t b = rx.front();
+        rx.pop_front();
+        return b;
+    }
+
+    void stop() override { up = false; }
+    uint8_t connected() override { return up; }
+
+    // Network drop: queued bytes in both directions are lost
+    void drop() {
+        up = false;
+        rx.clear();
+        tx.clear();
+    }
+
+    void ackPending() {
+        for (uint16_t packetId : unacked) {
+            queuePuback(packetId);
+        }
+        unacked.clear();
+    }
+
+    void injectPublish(const std::string& topic, const std::string& payload, uint16_t packetId) {
+        std::vector<uint8_t> body;
+        appendString(body, topic);
+        if (packetId != 0) {
+            body.push_back(packetId >> 8);
+            body.push_back(packetId & 0xFF);
+        }
+        body.push_back(0); // No properties
+        body.insert(body.end(), payload.begin(), payload.end());
+        queuePacket(packetId != 0 ? 0x32 : 0x30, body);
+    }
+
+private:
+    bool up = false;
+    std::deque<uint8_t> rx;
+    std::vector<uint8_t> tx;
+    std::map<uint16_t, std::string> aliases;
+
+    static void appendString(std::vector<uint8_t>& out, const std::string& text) {
+        out.push_back(text.size() >> 8);
+        out.push_back(text.size() & 0xFF);
+        out.insert(out.end(), text.begin(), text.end());
+    }
+
+    void queuePacket(uint8_t header, const std::vector<uint8_t>& body) {
+        rx.push_back(header);
+        size_t length = body.size();
+        do {
+            uint8_t digit = length % 128;
+            length /= 128;
+            rx.push_back(length > 0 ? digit | 0x80 : digit);
+        } while (length > 0);
+        rx.insert(rx.end(), body.begin(), body.end());
+    }
+
+    void queuePuback(uint16_t packetId) {
+        queuePacket(0x40, {(uint8_t)(packetId >> 8), (uint8_t)(packetId & 0xFF), ackReason});
+    }
+
+    void protocolError(const std::string& message) {
+        errors.push_back(message);
+        queuePacket(0xE0, {0x82}); // DISCONNECT, protocol error
+    }
+
+    void parsePackets() {
+        while (tx.size() >= 2) {
+            size_t pos = 1;
+            uint32_t length = 0;
+            uint32_t multiplier = 1;
+            while (true) {
+                if (pos >= tx.size()) {
+                    return;
+                }
+                uint8_t digit = tx[pos++];
+                length += (digit & 0x7F) * multiplier;
+                multiplier *= 128;
+                if ((digit & 0x80) == 0) {
+                    break;
+                }
+            }
+            if (tx.size() < pos + length) {
+                return;
+            }
+            std::vector<uint8_t> body(tx.begin() + pos, tx.begin() + pos + length);
+            uint8_t header = tx[0];
+            tx.erase(tx.begin(), tx.begin() + pos + length);
+            handle(header, body);
+        }
+    }
+
+    void handle(uint8_t header, const std::vector<uint8_t>& body) {
+        switch (header & 0xF0) {
+            case 0x10: {  // CONNECT
+                connects++;
+                aliases.clear();
+                std::vector<uint8_t> connack = {(uint8_t)(sessionPresent ? 1 : 0), 0x00, 6,
+                                                0x21, (uint8_t)(receiveMax >> 8), (uint8_t)(receiveMax & 0xFF),
+                                                0x22, (uint8_t)(topicAliasMax >> 8), (uint8_t)(topicAliasMax & 0xFF)};
+                queuePacket(0x20, connack);
+                break;
+            }
+            case 0x30:
+                handlePublish(header, body);
+                break;
+            case 0x40:
+                acksReceived.push_back((body[0] << 8) | body[1]);
+                break;
+            case 0x80:
+                queuePacket(0x90, {body[0], body[1], 0, 0x01});
+                break;
+            case 0xC0:
+                queuePacket(0xD0, {});
+                break;
+            case 0xE0:
+                up = false;
+                break;
+            default:
+                protocolError("unexpected packet type");
+                break;
+        }
+    }
+
+    void handlePublish(uint8_t header, const std::vector<uint8_t>& body) {
+        BrokerPublish publish = {};
+        publish.qos = (header >> 1) & 0x03;
+        publish.dup = header & 0x08;
+        publish.retained = header & 0x01;
+
+        size_t topicLength = (body[0] << 8) | body[1];
+        size_t pos = 2;
+        publish.topic.assign(body.begin() + pos, body.begin() + pos + topicLength);
+        publish.topicSent = topicLength > 0;
+        pos += topicLength;
+        if (publish.qos > 0) {
+            publish.packetId = (body[pos] << 8) | body[pos + 1];
+            pos += 2;
+        }
+
+        size_t propLength = body[pos++];  // Always < 128 from this client
+        size_t propEnd = pos + propLength;
+        while (pos < propEnd) {
+            if (body[pos] != 0x23) {
+                protocolError("unexpected publish property");
+                return;
+            }
+            publish.alias = (body[pos + 1] << 8) | body[pos + 2];
+            pos += 3;
+        }
+        publish.payload.assign(body.begin() + pos, body.end());
+
+        // Topic alias rules (MQTT 5.0, 3.3.2.3.4)
+        if (publish.alias > topicAliasMax) {
+            protocolError("topic alias above maximum");
+            return;
+        }
+        if (publish.topicSent && publish.alias > 0) {
+            aliases[publish.alias] = publish.topic;
+        } else if (!publish.topicSent) {
+            auto known = aliases.find(publish.alias);
+            if (publish.alias == 0 || known == aliases.end()) {
+                protocolError("empty topic with unknown alias " + std::to_string(publish.alias));
+                return;
+            }
+            publish.topic = known->second;
+        }
+
+        publishes.push_back(publish);
+        if (publish.qos == 1) {
+            if (autoAck) {
+                queuePuback(publish.packetId);
+            } else {
+                unacked.push_back(publish.packetId);
+            }
+        }
+    }
+};
+
+// Test plumbing
+static int failures = 0;
+static std::string currentCase;
+static std::string failure;
+
+#define EXPECT(condition) \
+    do { \
+        if (!(condition) && failure.empty()) { \
+            failure = std::string(#condition) + " (line " + std::to_string(__LINE__) + ")"; \
+        } \
+    } while (0)
+
+static bool publishText(Mqtt5Transport& transport, const char* topic, const std::string& payload) {
+    return transport.publish(topic, (const uint8_t*)payload.data(), payload.size(), false);
+}
+
+static std::string lastTopic;
+static std::string lastPayload;
+
+static void onMessage(char* topic, uint8_t* payload, unsigned int length) {
+    lastTopic = topic;
+    lastPayload.assign((const char*)payload, length);
+}
+
+static void runCase(const char* name, void (*body)(FakeBroker&, Mqtt5Transport&)) {
+    FakeBroker broker;
+    Mqtt5Transport transport(broker);
+    transport.setServer("broker", 1883);
+    transport.setCallback(onMessage);
+    currentCase = name;
+    failure.clear();
+
+    body(broker, transport);
+    if (failure.empty() && !broker.errors.empty()) {
+        failure = "broker: " + broker.errors.front();
+    }
+
+    if (failure.empty()) {
+        printf("PASS %s\n", name);
+    } else {
+        printf("FAIL %s: %s\n", name, failure.c_str());
+        failures++;
+    }
+}
+
+// Cases
+static void aliasSetupAndReuse(FakeBroker& broker, Mqtt5Transport& transport) {
+    EXPECT(transport.connect("node", "", ""));
+    EXPECT(publishText(transport, "poolio/gateway", "1"));
+    EXPECT(publishText(transport, "poolio/gateway", "2"));
+    EXPECT(publishText(transport, "poolio/temperature", "3"));
+
+    EXPECT(broker.publishes.size() == 3);
+    if (broker.publishes.size() == 3) {
+        EXPECT(broker.publishes[0].topicSent && broker.publishes[0].alias == 1);
+        EXPECT(!broker.publishes[1].topicSent && broker.publishes[1].alias == 1);
+        EXPECT(broker.publishes[1].topic == "poolio/gateway");
+        EXPECT(broker.publishes[2].topicSent && broker.publishes[2].alias == 2);
+    }
+}
+
+static void aliasLimitSendsTopic(FakeBroker& broker, Mqtt5Transport& transport) {
+    broker.topicAliasMax = 1;
+    EXPECT(transport.connect("node", "", ""));
+    EXPECT(publishText(transport, "a", "1"));
+    EXPECT(publishText(transport, "b", "2"));
+    EXPECT(publishText(transport, "b", "3"));
+
+    EXPECT(broker.publishes.size() == 3);
+    if (broker.publishes.size() == 3) {
+        EXPECT(broker.publishes[1].topicSent && broker.publishes[1].alias == 0);
+        EXPECT(broker.publishes[2].topicSent && broker.publishes[2].alias == 0);
+    }
+}
+
+static void aliasNotKeptOnFailedWrite(FakeBroker& broker, Mqtt5Transport& transport) {
+    EXPECT(transport.connect("node", "", ""));
+    broker.failWrites = 1;
+    EXPECT(!publishText(transport, "poolio/gateway", "lost"));
+    EXPECT(publishText(transport, "poolio/gateway", "1"));
+    EXPECT(publishText(transport, "poolio/gateway", "2"));
+
+    EXPECT(broker.publishes.size() == 2);
+    if (broker.publishes.size() == 2) {
+        EXPECT(broker.publishes[0].topicSent && broker.publishes[0].alias == 1);
+        EXPECT(!broker.publishes[1].topicSent && broker.publishes[1].topic == "poolio/gateway");
+    }
+}
+
+static void aliasNotKeptOnOversizedPublish(FakeBroker& broker, Mqtt5Transport& transport) {
+    EXPECT(transport.connect("node", "", ""));
+    EXPECT(!publishText(transport, "poolio/history", std::string(MQTT_BUFFER_SIZE, 'x')));
+    EXPECT(transport.inFlight() == 0);
+    EXPECT(publishText(transport, "poolio/history", "small"));
+
+    EXPECT(broker.publishes.size() == 1);
+    if (broker.publishes.size() == 1) {
+        EXPECT(broker.publishes[0].topicSent && broker.publishes[0].alias == 1);
+    }
+}
+
+static void pubackReleasesWindow(FakeBroker& broker, Mqtt5Transport& transport) {
+    EXPECT(transport.connect("node", "", ""));
+    broker.autoAck = false;
+    for (int i = 0; i < 3; i++) {
+        EXPECT(publishText(transport, "poolio/gateway", std::to_string(i)));
+    }
+    EXPECT(transport.inFlight() == 3);
+
+    broker.ackPending();
+    transport.loop();
+    EXPECT(transport.inFlight() == 0);
+    EXPECT(transport.getAckedCount() == 3);
+}
+
+static void pubackRejection(FakeBroker& broker, Mqtt5Transport& transport) {
+    EXPECT(transport.connect("node", "", ""));
+    broker.ackReason = 0x87; // Not authorized
+    EXPECT(publishText(transport, "poolio/gateway", "1"));
+    EXPECT(transport.flush(1000));
+    EXPECT(transport.getRejectedCount() == 1);
+    EXPECT(transport.getAckedCount() == 0);
+}
+
+static void windowFullTimesOut(FakeBroker& broker, Mqtt5Transport& transport) {
+    broker.receiveMax = 2;
+    broker.autoAck = false;
+    EXPECT(transport.connect("node", "", ""));
+    EXPECT(publishText(transport, "poolio/gateway", "1"));
+    EXPECT(publishText(transport, "poolio/gateway", "2"));
+
+    unsigned long start = millis();
+    EXPECT(!publishText(transport, "poolio/gateway", "3"));
+    EXPECT(millis() - start >= MQTT_ACK_TIMEOUT_MS);
+    EXPECT(transport.inFlight() == 2);
+    EXPECT(broker.publishes.size() == 2);
+
+    // Acks arriving while the window is full let the next publish through
+    broker.ackPending();
+    EXPECT(publishText(transport, "poolio/gateway", "4"));
+}
+
+static void reconnectResendsPending(FakeBroker& broker, Mqtt5Transport& transport) {
+    EXPECT(transport.connect("node", "", ""));
+    broker.autoAck = false;
+    EXPECT(publishText(transport, "poolio/gateway", "1"));
+    EXPECT(publishText(transport, "poolio/temperature", "2"));
+    EXPECT(transport.inFlight() == 2);
+    std::vector<uint16_t> sentIds = broker.unacked;
+
+    broker.drop();
+    EXPECT(!transport.connected());
+    EXPECT(!publishText(transport, "poolio/gateway", "offline"));
+
+    broker.sessionPresent = true;
+    broker.unacked.clear();
+    broker.publishes.clear();
+    EXPECT(transport.connect("node", "", ""));
+    EXPECT(transport.isSessionPresent());
+
+    // Resent with DUP and the original packet IDs; aliases start over on the new connection
+    EXPECT(broker.publishes.size() == 2);
+    for (const BrokerPublish& publish : broker.publishes) {
+        EXPECT(publish.dup && publish.topicSent);
+    }
+    EXPECT(broker.unacked == sentIds);
+
+    EXPECT(publishText(transport, "poolio/gateway", "3"));
+    EXPECT(broker.publishes.size() == 3);
+    if (broker.publishes.size() == 3) {
+        EXPECT(!broker.publishes[2].dup && broker.publishes[2].topic == "poolio/gateway");
+    }
+
+    broker.ackPending();
+    EXPECT(transport.flush(1000));
+    EXPECT(transport.getAckedCount() == 3);
+}
+
+static void reconnectWithoutSession(FakeBroker& broker, Mqtt5Transport& transport) {
+    EXPECT(transport.connect("node", "", ""));
+    broker.autoAck = false;
+    EXPECT(publishText(transport, "poolio/gateway", "1"));
+
+    broker.drop();
+    broker.autoAck = true;
+    broker.publishes.clear();
+    EXPECT(transport.connect("node", "", ""));
+    EXPECT(!transport.isSessionPresent());
+
+    // A new session never saw the publish, so it goes out again as a first delivery
+    EXPECT(broker.publishes.size() == 1);
+    if (broker.publishes.size() == 1) {
+        EXPECT(!broker.publishes[0].dup && broker.publishes[0].payload == "1");
+    }
+    EXPECT(transport.flush(1000));
+}
+
+static void inboundPublishIsAcked(FakeBroker& broker, Mqtt5Transport& transport) {
+    EXPECT(transport.connect("node", "", ""));
+    EXPECT(transport.subscribe("poolio/config"));
+    lastTopic.clear();
+
+    broker.injectPublish("poolio/config", "{\"sleep_duration\":600}", 77);
+    transport.loop();
+    EXPECT(lastTopic == "poolio/config");
+    EXPECT(lastPayload == "{\"sleep_duration\":600}");
+    EXPECT(broker.acksReceived.size() == 1 && broker.acksReceived[0] == 77);
+}
+
+static void bufferedDataReported(FakeBroker& broker, Mqtt5Transport& transport) {
+    EXPECT(transport.connect("node", "", ""));
+    EXPECT(transport.subscribe("poolio/config"));
+    EXPECT(transport.hasBufferedData());    // SUBACK
+    transport.loop();
+    EXPECT(!transport.hasBufferedData());
+
+    // Unread bytes in the client
+    broker.injectPublish("poolio/config", "{\"sleep_duration\":600}", 0);
+    EXPECT(transport.hasBufferedData());
+
+    // Half a packet read, the rest not yet arrived
+    broker.deliverLimit = 6;
+    transport.loop();
+    broker.deliverLimit = 0;
+    EXPECT(transport.hasBufferedData());
+
+    broker.deliverLimit = -1;
+    transport.loop();
+    EXPECT(!transport.hasBufferedData());
+}
+
+static void keepaliveTimeout(FakeBroker& broker, Mqtt5Transport& transport) {
+    transport.setKeepAlive(1);
+    EXPECT(transport.connect("node", "", ""));
+    delay(1000);
+    EXPECT(transport.loop());    // PINGREQ, answered at once
+    EXPECT(transport.loop());    // PINGRESP read
+    EXPECT(transport.connected());
+
+    broker.drop();
+    EXPECT(!transport.loop());
+    EXPECT(transport.state() == MQTT_CONNECTION_LOST);
+}
+
+int main(int argc, char** argv) {
+    Serial.verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+
+    runCase("alias_setup_and_reuse", aliasSetupAndReuse);
+    runCase("alias_limit_sends_topic", aliasLimitSendsTopic);
+    runCase("alias_not_kept_on_failed_write", aliasNotKeptOnFailedWrite);
+    runCase("alias_not_kept_on_oversized_publish", aliasNotKeptOnOversizedPublish);
+    runCase("puback_releases_window", pubackReleasesWindow);
+    runCase("puback_rejection", pubackRejection);
+    runCase("window_full_times_out", windowFullTimesOut);
+    runCase("reconnect_resends_pending", reconnectResendsPending);
+    runCase("reconnect_without_session", reconnectWithoutSession);
+    runCase("inbound_publish_is_acked", inboundPublishIsAcked);
+    runCase("buffered_data_reported", bufferedDataReported);
+    runCase("keepalive_timeout", keepaliveTimeout);
+
+    printf("%d failed\n", failures);
+    return failures;
+}
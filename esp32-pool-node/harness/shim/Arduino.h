@@ -0,0 +1,35 @@
+// Minimal Arduino API for the MQTT transport harness on Linux.
+// Time is virtual: delay() advances millis() instantly (mqtt5_harness.cpp).
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+class String {
+public:
+    String(const char* text = "") : value(text ? text : "") {}
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.length(); }
+
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator==(const char* other) const { return value == other; }
+
+private:
+    std::string value;
+};
+
+class HardwareSerial {
+public:
+    bool verbose = false;
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    size_t println(const char* text = "");
+};
+
+extern HardwareSerial Serial;
+
+unsigned long millis();
+void delay(unsigned long ms);
@@ -0,0 +1,14 @@
+// State codes shared with PubSubClient; the PubSubTransport itself is not built here
+#pragma once
+#include <Client.h>
+
+#define MQTT_CONNECTION_TIMEOUT     -4
+#define MQTT_CONNECTION_LOST        -3
+#define MQTT_CONNECT_FAILED         -2
+#define MQTT_DISCONNECTED           -1
+#define MQTT_CONNECTED               0
+
+class PubSubClient {
+public:
+    explicit PubSubClient(Client&) {}
+};
@@ -7,6 +7,9 @@
 #define FLOAT_SWITCH_PIN_2 12   // Float switch input 2 (D12)
 #define LED_PIN LED_BUILTIN     // Built-in LED
 #define BATTERY_ADC_PIN A13     // Battery voltage monitoring (GPIO2/A13)
+#define PH_PROBE_PIN 5          // pH amplifier output (D5, ADC1)
+#define ORP_PROBE_PIN 6         // ORP amplifier output (D6, ADC1)
+#define PRESSURE_PROBE_PIN 8    // Pressure transducer via 2:3 divider (A5, ADC1)
 
 // Network configuration
 #define WIFI_TIMEOUT_MS 30000
@@ -15,27 +18,145 @@
 
 // Hub configuration (your Ubuntu server)
 #define MQTT_BROKER_HOST "192.168.68.120"
+#define MQTT_USE_TLS 0              // Requires MQTT_CA_CERT in secrets.h
+#if MQTT_USE_TLS
+#define MQTT_BROKER_PORT 8883
+#else
 #define MQTT_BROKER_PORT 1883
+#endif
 #define MQTT_CLIENT_ID "pool-node-esp32"
 
+// MQTT transport selection
+#define MQTT_TRANSPORT_PUBSUB 0   // PubSubClient, MQTT 3.1.1, QoS0 only
+#define MQTT_TRANSPORT_MQTT5 1    // Asynchronous MQTT 5 client (mqtt5_transport.cpp)
+#define MQTT_TRANSPORT MQTT_TRANSPORT_PUBSUB
+#define MQTT_BUFFER_SIZE 1024
+#define MQTT_PUBLISH_OVERHEAD 13    // Fixed header, topic length, packet id and MQTT 5 properties
+#define MQTT_PUBLISH_QOS 0          // MQTT5 transport only; the hub backfills sequence gaps
+#define MQTT_INFLIGHT_WINDOW 8      // Unacknowledged QoS1 publishes allowed on the wire
+#define MQTT_ACK_TIMEOUT_MS 5000
+#define MQTT_PERSISTENT_SESSION 1   // Keep broker session (subscriptions, queued config) across sleep
+#define MQTT_SESSION_EXPIRY_S 3600  // Must exceed the sleep duration
+#define MQTT_TOPIC_ALIAS_MAX 8
+
+// TLS session resumption (session cached in RTC memory across deep sleep)
+#define MQTT_TLS_HANDSHAKE_TIMEOUT_MS 10000
+#define MQTT_TLS_SERVER_NAME "poolio-hub"   // DNS SAN checked in the broker certificate (mbedtls 2.x ignores IP SANs)
+#define MQTT_TLS_SESSION_CACHE_SIZE 1536  // Serialized session incl. peer certificate
+
+// Node role
+#define NODE_ROLE_STANDALONE 0  // WiFi + MQTT on every wake
+#define NODE_ROLE_GATEWAY 1     // Mains powered; relays ESP-NOW leaf readings over MQTT
+#define NODE_ROLE_LEAF 2        // Sends readings to the gateway over ESP-NOW, never joins WiFi
+#define NODE_ROLE NODE_ROLE_STANDALONE
+
+// ESP-NOW relay (gateway prints its MAC and channel at startup)
+#define ESPNOW_CHANNEL 1        // Leaf only: must match the gateway's AP channel
+#define ESPNOW_GATEWAY_MAC {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}  // Leaf only: must be set (frames are encrypted)
+#define ESPNOW_LEAF_MACS {{0x00, 0x00, 0x00, 0x00, 0x00, 0x00}}  // Gateway only: leaves allowed to relay (each leaf prints its MAC)
+#define ESPNOW_SEND_TIMEOUT_MS 50
+#define ESPNOW_SEND_RETRIES 3
+#define ESPNOW_QUEUE_LENGTH 8
+
 // MQTT Topics
 #define TOPIC_GATEWAY "poolio/gateway"
 #define TOPIC_TEMPERATURE "poolio/temperature" 
 #define TOPIC_BATTERY "poolio/battery"
-#define TOPIC_CONFIG "poolio/config"
+#define TOPIC_CONFIG "poolio/config"         // Shared commands; per-device mailbox is poolio/config/<device_id>
+#define TOPIC_CONFIG_ACK "poolio/config_ack" // Fields applied from the mailbox
+#define TOPIC_COMMAND_SUFFIX "/cmd"          // Retained hub commands: poolio/config/<device_id>/cmd
 #define TOPIC_STATUS "poolio/status"
+#define TOPIC_HISTORY "poolio/history"  // Readings buffered while offline
+#define TOPIC_RELAY "poolio/relay"      // Relayed leaf readings: poolio/relay/<device_id>
+#define TOPIC_PROBE_PREFIX "poolio/"    // Analog probes publish to poolio/<sensor_type>
+#define TOPIC_TRACE "poolio/trace"      // Sensor trace chunks: poolio/trace/<device_id>
+
+// Power mode between sensor cycles
+#define POWER_MODE_ALWAYS_ON 0    // CPU and radio fully on, 20 s test cycles
+#define POWER_MODE_LIGHT_SLEEP 1  // Auto light sleep + DTIM modem sleep, MQTT session kept alive
+#ifndef POWER_MODE  // The light_sleep environment sets it on the command line
+#define POWER_MODE POWER_MODE_ALWAYS_ON
+#endif
+#define LIGHT_SLEEP_MIN_FREQ_MHZ 40           // XTAL frequency while idle
+#define LIGHT_SLEEP_WIFI_PS WIFI_PS_MIN_MODEM // Wake every DTIM; WIFI_PS_MAX_MODEM uses the listen interval
+#define LIGHT_SLEEP_MAX_IDLE_MS 5000          // Loop runs at least this often (keepalive, watchdog)
+
+// CPU frequency per wake-cycle phase (power_manager.h)
+#define CPU_FREQ_SCALING_ENABLED 1
+#define CPU_FREQ_BOOST_MHZ 240    // Held by CpuBoost scopes: TLS, serialization, ADC filtering
+#define CPU_FREQ_ACQUIRE_MHZ 80   // OneWire conversions, float-switch sampling, ADC DMA
+#define CPU_FREQ_CONNECT_MHZ 80   // WiFi association, DNS, TCP round trips
+#define CPU_FREQ_PUBLISH_MHZ 80
+#define CPU_FREQ_DRAIN_MHZ 80
+#define CPU_FREQ_IDLE_MHZ 80      // Outside phases; 80 MHz is the lowest step that keeps WiFi running
+
+// Remote configuration (node_config.h): the values below are the defaults until
+// the retained mailbox changes them; changed settings are kept in NVS
+#define REMOTE_CONFIG_WAIT_MS 500     // Wait for the retained mailbox after connecting
+#define DEFAULT_LOG_LEVEL 3           // ESP_LOG_INFO, same as CORE_DEBUG_LEVEL
 
 // Sleep and timing configuration
 #define DEFAULT_SLEEP_DURATION_S 300  // 5 minutes
 #define SENSOR_READ_RETRIES 3
-#define FLOAT_SWITCH_SAMPLES 100  // 100 samples * 100ms = 10 seconds
+#define MAX17048_I2C_ADDRESS 0x36
+
+// Per-sensor circuit breaker (sensor_health.h)
+#define SENSOR_HEALTH_SLOTS 8           // Sensors tracked in RTC memory
+#define SENSOR_FAILURE_THRESHOLD 3      // Consecutive failed reads before a sensor is skipped
+#define SENSOR_BACKOFF_INITIAL_S 60     // First re-probe delay; doubles after each failed probe
+#define SENSOR_BACKOFF_MAX_S 3600
+#define FLOAT_SWITCH_SAMPLES 10   // 10 samples * 100ms = 1 second
+#define FLOAT_SWITCH_SAMPLE_MS 115   // 100 ms delay plus pin reads and LED blinks
+#define TEMPERATURE_ATTEMPT_MS 1750  // 750 ms conversion, 1 s before a retry
 #define TEMPERATURE_PRECISION 12
 
+// Analog probes (pH, ORP, pressure level) on the ADC DMA pipeline
+#define ANALOG_PROBES_ENABLED 0   // Set to 1 once the probes are wired
+#define ADC_SAMPLE_RATE_HZ 20000
+#define ADC_BURST_SAMPLES 2000    // 100 ms: whole mains cycles at both 50 and 60 Hz
+#define ADC_CAPTURE_TIMEOUT_MS 500
+#define ADC_FIR_TAPS 32
+#define ADC_DECIMATION 8
+#define ADC_TRIM_PERCENT 10       // Decimated samples dropped from each end before averaging
+#define ADC_RAIL_MARGIN 16        // Counts from 0/4095 treated as a railed input
+#define ADC_NOISE_LIMIT_COUNTS 40.0 // Std-dev of decimated samples, mains hum included
+
+// Sensor trace recording (trace_format.h); replay with replay/sensor_replay.cpp
+#define TRACE_SINK_NONE 0
+#define TRACE_SINK_MQTT 1         // One binary chunk per cycle to poolio/trace/<device_id>
+#define TRACE_SINK_FLASH 2        // Appended to TRACE_FLASH_FILE on LittleFS
+#define TRACE_SINK TRACE_SINK_NONE
+#define TRACE_BUFFER_SIZE 896     // Per-cycle chunk; must fit MQTT_BUFFER_SIZE with the topic
+#define TRACE_MAX_PINS 64
+#define TRACE_FLASH_FILE "/sensor_trace.bin"
+#define TRACE_FLASH_MAX_BYTES 262144  // Rotated to /sensor_trace.old.bin beyond this
+#define TRACE_UPLOAD_SLICES_PER_LOOP 8  // TRACE_BUFFER_SIZE slices published per loop() during an upload
+
+// Memory
+#define JSON_ARENA_SIZE 4096  // Per-cycle ArduinoJson arena (json_arena.cpp)
+
 // Power management
 #define LOW_BATTERY_THRESHOLD 3.3
 #define CRITICAL_BATTERY_THRESHOLD 3.0
 #define WATCHDOG_TIMEOUT_S 45
 
+// Wake-cycle phase budgets (sum must stay below WATCHDOG_TIMEOUT_S)
+#define BUDGET_ACQUIRE_MS 16000   // Float debounce + temperature retries (3 x 1.75 s)
+#define BUDGET_CONNECT_MS 18000   // WiFi + MQTT, across all networks and retries
+#define BUDGET_PUBLISH_MS 5000
+#define BUDGET_DRAIN_MS 3000
+
+// Readings kept in RTC memory: pending ones until published, sent ones for backfill
+#define READING_BUFFER_CAPACITY 48
+#define HISTORY_BATCH_SIZE 8      // Most buffered readings per poolio/history message; fewer if they would not fit one publish
+#define SEQUENCE_RESERVE_BLOCK 64 // Sequence numbers reserved per NVS write
+
+// Buffered history upload format
+#define HISTORY_FORMAT_JSON 0     // Up to HISTORY_BATCH_SIZE readings per JSON message on TOPIC_HISTORY
+#define HISTORY_FORMAT_SERIES 1   // Compressed blocks on TOPIC_HISTORY/<device_id> (see series_codec.h)
+#define HISTORY_FORMAT HISTORY_FORMAT_JSON
+#define SERIES_BLOCK_SIZE 512     // Bytes per block; must fit MQTT_BUFFER_SIZE with the topic
+
 // Device identification
 #define DEVICE_ID "pool-node-001"
 #define FIRMWARE_VERSION "1.0.0"
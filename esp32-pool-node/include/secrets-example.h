@@ -3,7 +3,7 @@
 
 // WiFi credentials - update with your networks
 // Copy this file to secrets.h and update with your actual credentials
-const char* WIFI_NETWORKS[][2] = {
+static const char* WIFI_NETWORKS[][2] = {
     {"YourHomeWiFi", "your-wifi-password"},
     {"YourBackupWiFi", "backup-wifi-password"},
     {"YourMobileHotspot", "hotspot-password"},
@@ -15,6 +15,19 @@ const char* WIFI_NETWORKS[][2] = {
 #define MQTT_USERNAME ""
 #define MQTT_PASSWORD ""
 
+// CA certificate for MQTT over TLS (MQTT_USE_TLS in config.h)
+// Paste the PEM of the CA that signed your broker certificate
+static const char MQTT_CA_CERT[] = R"PEM(
+-----BEGIN CERTIFICATE-----
+...your CA certificate...
+-----END CERTIFICATE-----
+)PEM";
+
+// ESP-NOW relay keys (NODE_ROLE_GATEWAY / NODE_ROLE_LEAF): exactly 16 characters each,
+// the same on the gateway and every leaf. PMK encrypts the LMK; LMK encrypts the frames.
+#define ESPNOW_PMK "change-this-pmk!"
+#define ESPNOW_LMK "change-this-lmk!"
+
 // OTA update password (for future secure firmware updates)
 // Choose a strong password for over-the-air updates
 #define OTA_PASSWORD "change-this-strong-password"
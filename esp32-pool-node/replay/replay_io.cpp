@@ -0,0 +1,160 @@
+#include "replay_io.h"
+#include <Arduino.h>
+#include <DallasTemperature.h>
+#include <Adafruit_MAX1704X.h>
+#include <Wire.h>
+#include <stdio.h>
+
+ReplayIO replayIO;
+bool replayVerbose = false;
+
+HardwareSerial Serial;
+TwoWire Wire;
+
+// ReplayIO Implementation
+bool ReplayIO::load(const std::vector<uint8_t>& data) {
+    TraceReader reader(data.data(), data.size());
+    TraceChunkInfo info;
+
+    while (reader.nextChunk(info)) {
+        ReplayChunk chunk = {info, {}};
+        size_t chunkIndex = chunks.size();
+        ReplayOperation* open = nullptr;
+        TraceRecord record;
+
+        while (reader.next(record)) {
+            switch (record.type) {
+                case TRACE_BEGIN:
+                    operations.push_back({chunkIndex, record.op, record.sensorId,
+                                          record.timeMs, record.timeMs, {}});
+                    open = &operations.back();
+                    break;
+                case TRACE_END:
+                    if (open) {
+                        open->endMs = record.timeMs;
+                        open = nullptr;
+                    }
+                    break;
+                case TRACE_DIGITAL:
+                    chunk.pinLevels[record.pin].push_back({record.timeMs, record.level});
+                    break;
+                case TRACE_VALUE:
+                    if (open) {
+                        open->values.push_back({record.channel, record.value});
+                    }
+                    break;
+            }
+        }
+
+        chunks.push_back(chunk);
+    }
+
+    return !operations.empty();
+}
+
+void ReplayIO::enter(const ReplayOperation& operation) {
+    current = &operation;
+    consumed = 0;
+    cursors.clear();
+    clockMs = operation.startMs;
+}
+
+size_t ReplayIO::leave() {
+    size_t unused = current ? current->values.size() - consumed : 0;
+    current = nullptr;
+    return unused;
+}
+
+int ReplayIO::digitalRead(int pin) {
+    // Sample-and-hold: the last level recorded at or before the virtual clock
+    if (current) {
+        auto levels = chunks[current->chunk].pinLevels.find(pin);
+        if (levels != chunks[current->chunk].pinLevels.end() && !levels->second.empty()) {
+            int level = levels->second.front().second;
+            for (const auto& change : levels->second) {
+                if (change.first > clockMs) {
+                    break;
+                }
+                level = change.second;
+            }
+            return level;
+        }
+    }
+
+    unrecordedPinReads++;
+    return HIGH;  // Idle level of the pulled-up float switch inputs
+}
+
+float ReplayIO::nextValue(TraceChannel channel, float fallback) {
+    if (current) {
+        size_t& cursor = cursors[channel];
+        while (cursor < current->values.size()) {
+            const auto& entry = current->values[cursor++];
+            if (entry.first == channel) {
+                consumed++;
+                return entry.second;
+            }
+        }
+    }
+
+    exhaustedValues++;
+    return fallback;
+}
+
+// Arduino shim
+size_t HardwareSerial::print(const char* text) {
+    return replayVerbose ? fputs(text, stderr) : 0;
+}
+
+size_t HardwareSerial::println(const char* text) {
+    return replayVerbose ? fprintf(stderr, "%s\n", text) : 0;
+}
+
+int HardwareSerial::printf(const char* format, ...) {
+    if (!replayVerbose) {
+        return 0;
+    }
+    va_list args;
+    va_start(args, format);
+    int written = vfprintf(stderr, format, args);
+    va_end(args);
+    return written;
+}
+
+unsigned long millis() {
+    return replayIO.millis();
+}
+
+unsigned long micros() {
+    return replayIO.millis() * 1000UL;
+}
+
+void delay(unsigned long ms) {
+    replayIO.delay(ms);
+}
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+int digitalRead(uint8_t pin) {
+    return replayIO.digitalRead(pin);
+}
+
+void digitalWrite(uint8_t, uint8_t) {
+}
+
+float DallasTemperature::getTempFByIndex(uint8_t) {
+    return replayIO.nextValue(TRACE_TEMPERATURE_F, DEVICE_DISCONNECTED_F);
+}
+
+bool Adafruit_MAX17048::begin() {
+    return replayIO.nextValue(TRACE_BATTERY_PRESENT, 0.0f) != 0.0f;
+}
+
+float Adafruit_MAX17048::cellVoltage() {
+    return replayIO.nextValue(TRACE_BATTERY_VOLTAGE, NAN);
+}
+
+float Adafruit_MAX17048::cellPercent() {
+    return replayIO.nextValue(TRACE_BATTERY_PERCENT, NAN);
+}
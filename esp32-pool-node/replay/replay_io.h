@@ -0,0 +1,66 @@
+#ifndef REPLAY_IO_H
+#define REPLAY_IO_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "trace_format.h"
+
+// One recorded initialize()/readData() call
+struct ReplayOperation {
+    size_t chunk;
+    uint8_t op;
+    std::string sensorId;
+    uint32_t startMs;
+    uint32_t endMs;
+    std::vector<std::pair<uint8_t, float>> values;  // (channel, reading) in recorded order
+};
+
+struct ReplayChunk {
+    TraceChunkInfo info;
+    std::map<int, std::vector<std::pair<uint32_t, int>>> pinLevels;  // pin -> (time, level) changes
+};
+
+// Serves the Arduino shim from a loaded trace. Time is virtual: delay()
+// advances the clock instantly, so a 10 s debounce replays in microseconds
+// and every run of the same trace sees exactly the same inputs.
+class ReplayIO {
+public:
+    bool load(const std::vector<uint8_t>& data);
+
+    const std::vector<ReplayChunk>& getChunks() const { return chunks; }
+    const std::vector<ReplayOperation>& getOperations() const { return operations; }
+
+    // Positions the clock and value cursors at the start of `operation`
+    void enter(const ReplayOperation& operation);
+    // Returns how many recorded values the code under test did not consume
+    size_t leave();
+
+    unsigned long millis() const { return clockMs; }
+    void delay(unsigned long ms) { clockMs += ms; }
+    int digitalRead(int pin);
+    float nextValue(TraceChannel channel, float fallback);
+
+    // Inputs the code under test asked for but the trace does not contain
+    unsigned long getExhaustedValues() const { return exhaustedValues; }
+    unsigned long getUnrecordedPinReads() const { return unrecordedPinReads; }
+
+private:
+    std::vector<ReplayChunk> chunks;
+    std::vector<ReplayOperation> operations;
+
+    const ReplayOperation* current = nullptr;
+    size_t consumed = 0;
+    std::map<uint8_t, size_t> cursors;
+    uint32_t clockMs = 0;
+
+    unsigned long exhaustedValues = 0;
+    unsigned long unrecordedPinReads = 0;
+};
+
+extern ReplayIO replayIO;
+extern bool replayVerbose;
+
+#endif
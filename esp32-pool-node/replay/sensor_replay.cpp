@@ -0,0 +1,145 @@
+// Replays recorded sensor traces through the real sensor classes on Linux.
+//
+// Build from esp32-pool-node/ as one command (ArduinoJson is header-only; any v7 copy
+// works, e.g. the one PlatformIO downloaded into .pio/libdeps):
+//   g++ -O2 -std=gnu++17 -DARDUINOJSON_ENABLE_ARDUINO_STRING=1
+//       -Ireplay/shim -Ireplay -Isrc -Iinclude -I<ArduinoJson>/src
+//       replay/sensor_replay.cpp replay/replay_io.cpp src/sensors.cpp src/sensor_health.cpp src/sensor_trace.cpp
+//       src/trace_format.cpp src/cycle_budget.cpp src/json_arena.cpp -o /tmp/sensor_replay
+//
+// Run:
+//   /tmp/sensor_replay [-v] trace.bin [more.bin ...]
+//
+// Inputs are chunks from TRACE_SINK_MQTT (mosquitto_sub -t 'poolio/trace/#' -N > trace.bin)
+// or TRACE_SINK_FLASH. Every recorded initialize()/readData() call is re-run against
+// the recorded pin levels and driver readings with a virtual clock, and printed as one
+// "REPLAY {json}" line. Diff the output of two firmware revisions to regression-test
+// validation, debouncing and budget changes; wall_us times the code under test.
+// -v forwards the sensors' Serial output to stderr.
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <stdio.h>
+#include "config.h"
+#include "sensors.h"
+#include "json_arena.h"
+#include "cycle_budget.h"
+#include "replay_io.h"
+
+// Same sensors and IDs as setupSensors() in main.cpp
+static std::unique_ptr<PoolSensor> createSensor(const std::string& sensorId) {
+    if (sensorId == "temp_01") {
+        return std::unique_ptr<PoolSensor>(new TemperatureSensor("temp_01", TEMP_SENSOR_PIN));
+    }
+    if (sensorId == "water_level_01") {
+        return std::unique_ptr<PoolSensor>(new WaterLevelSensor("water_level_01", FLOAT_SWITCH_PIN_1, FLOAT_SWITCH_PIN_2));
+    }
+    if (sensorId == "battery_01") {
+        return std::unique_ptr<PoolSensor>(new BatterySensor("battery_01", BATTERY_ADC_PIN));
+    }
+    return nullptr;
+}
+
+static bool readFile(const char* path, std::vector<uint8_t>& data) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    data.insert(data.end(), std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::vector<uint8_t> data;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            replayVerbose = true;
+        } else if (!readFile(argv[i], data)) {
+            fprintf(stderr, "Cannot open %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (!replayIO.load(data)) {
+        fprintf(stderr, "Usage: %s [-v] trace.bin [...]\nNo sensor trace chunks found\n", argv[0]);
+        return 1;
+    }
+
+    std::map<std::string, std::unique_ptr<PoolSensor>> sensors;
+    size_t currentChunk = SIZE_MAX;
+    bool acquiring = false;
+    unsigned long skipped = 0;
+    unsigned long unusedValues = 0;
+    double totalWallUs = 0;
+
+    for (const ReplayOperation& operation : replayIO.getOperations()) {
+        // Each chunk is one wake cycle: new arena cycle, sensor reads inside the acquire budget
+        if (operation.chunk != currentChunk) {
+            cycleBudget.endPhase();
+            jsonArena.reset();
+            currentChunk = operation.chunk;
+            acquiring = false;
+        }
+
+        // An init in the trace means the node booted; start from a fresh instance like the device
+        if (operation.op == TRACE_OP_INIT || !sensors[operation.sensorId]) {
+            sensors[operation.sensorId] = createSensor(operation.sensorId);
+        }
+        PoolSensor* sensor = sensors[operation.sensorId].get();
+        if (!sensor) {
+            skipped++;
+            continue;
+        }
+
+        replayIO.enter(operation);
+        if (operation.op == TRACE_OP_READ && !acquiring) {
+            cycleBudget.beginPhase(PHASE_ACQUIRE);
+            acquiring = true;
+        }
+
+        JsonDocument line;
+        auto wallStart = std::chrono::steady_clock::now();
+        if (operation.op == TRACE_OP_INIT) {
+            line["result"]["initialized"] = sensor->initialize();
+        } else {
+            line["result"] = sensor->readData();
+        }
+        double wallUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - wallStart).count();
+        unsigned long replayedMs = replayIO.millis() - operation.startMs;
+        size_t unused = replayIO.leave();
+
+        totalWallUs += wallUs;
+        unusedValues += unused;
+
+        const ReplayChunk& chunk = replayIO.getChunks()[operation.chunk];
+        line["chunk"] = operation.chunk;
+        line["node_clock_s"] = chunk.info.nodeClockS;
+        line["sensor_id"] = operation.sensorId;
+        line["op"] = operation.op == TRACE_OP_INIT ? "init" : "read";
+        line["recorded_ms"] = operation.endMs - operation.startMs;
+        line["replayed_ms"] = replayedMs;
+        line["wall_us"] = wallUs;
+        if (unused > 0) {
+            line["unused_values"] = unused;
+        }
+        if (chunk.info.flags & TRACE_FLAG_TRUNCATED) {
+            line["truncated"] = true;
+        }
+
+        std::string output;
+        serializeJson(line, output);
+        printf("REPLAY %s\n", output.c_str());
+    }
+    cycleBudget.endPhase();
+
+    printf("REPLAY_SUMMARY {\"chunks\":%zu,\"operations\":%zu,\"skipped\":%lu,\"exhausted_values\":%lu,"
+           "\"unused_values\":%lu,\"unrecorded_pin_reads\":%lu,\"wall_us\":%.1f}\n",
+           replayIO.getChunks().size(), replayIO.getOperations().size(), skipped,
+           replayIO.getExhaustedValues(), unusedValues, replayIO.getUnrecordedPinReads(), totalWallUs);
+    return 0;
+}
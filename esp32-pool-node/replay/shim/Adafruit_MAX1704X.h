@@ -0,0 +1,11 @@
+#pragma once
+#include <Arduino.h>
+
+// Presence, voltage and percentage are replayed from the trace
+class Adafruit_MAX17048 {
+public:
+    bool begin();
+    uint16_t getChipID() { return 0; }
+    float cellVoltage();
+    float cellPercent();
+};
@@ -0,0 +1,72 @@
+// Minimal Arduino API for replaying sensor traces on Linux.
+// Time, pins and driver readings come from the loaded trace (replay_io.cpp);
+// only what the sensor classes use is provided.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <stdarg.h>
+#include <string>
+
+using std::isnan;
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define LED_BUILTIN 13
+#define A13 2
+#define RTC_DATA_ATTR
+
+class String {
+public:
+    String(const char* text = "") : value(text ? text : "") {}
+    String(const std::string& text) : value(text) {}
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.length(); }
+    bool concat(const char* text) { value += text; return true; }
+    bool concat(char c) { value += c; return true; }
+
+    String& operator+=(const String& other) { value += other.value; return *this; }
+    String& operator+=(char c) { value += c; return *this; }
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator==(const char* other) const { return value == other; }
+    bool operator!=(const String& other) const { return value != other.value; }
+
+private:
+    std::string value;
+};
+
+// ArduinoJson recognises the type produced by String concatenation
+class StringSumHelper : public String {
+public:
+    using String::String;
+};
+
+inline StringSumHelper operator+(const String& a, const String& b) {
+    return StringSumHelper((std::string(a.c_str()) + b.c_str()).c_str());
+}
+
+class HardwareSerial {
+public:
+    void begin(unsigned long) {}
+    void flush() {}
+    size_t print(const char* text);
+    size_t println(const char* text = "");
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
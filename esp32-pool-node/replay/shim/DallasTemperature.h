@@ -0,0 +1,14 @@
+#pragma once
+#include <OneWire.h>
+
+#define DEVICE_DISCONNECTED_F -196.6f
+
+// Conversions are replayed in recorded order (TRACE_TEMPERATURE_F)
+class DallasTemperature {
+public:
+    explicit DallasTemperature(OneWire*) {}
+    void begin() {}
+    void setResolution(uint8_t) {}
+    void requestTemperatures() {}
+    float getTempFByIndex(uint8_t index);
+};
@@ -0,0 +1,9 @@
+#pragma once
+#include <Arduino.h>
+
+class OneWire {
+public:
+    explicit OneWire(uint8_t pin) : pin(pin) {}
+    uint8_t reset() { return 1; }
+    uint8_t pin;
+};
@@ -0,0 +1,32 @@
+// In-memory NVS for host builds; values last for the life of the process.
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <string>
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false) {
+        space = name;
+        return true;
+    }
+    void end() {}
+
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0) {
+        auto it = store()[space].find(key);
+        return it == store()[space].end() ? defaultValue : it->second;
+    }
+    size_t putUInt(const char* key, uint32_t value) {
+        store()[space][key] = value;
+        return sizeof(value);
+    }
+
+private:
+    static std::map<std::string, std::map<std::string, uint32_t>>& store() {
+        static std::map<std::string, std::map<std::string, uint32_t>> values;
+        return values;
+    }
+
+    std::string space;
+};
@@ -0,0 +1,12 @@
+#pragma once
+#include <Arduino.h>
+
+// No I2C bus during replay: every address NACKs
+class TwoWire {
+public:
+    bool begin(int, int) { return true; }
+    void beginTransmission(uint8_t) {}
+    uint8_t endTransmission() { return 2; }
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,113 @@
+#include "adc_sampler.h"
+#include "config.h"
+#include <driver/adc.h>
+#include <soc/soc_caps.h>
+
+// One DMA frame; each conversion result is SOC_ADC_DIGI_RESULT_BYTES long
+#define ADC_FRAME_BYTES 256
+#define ADC_DMA_BUFFER_BYTES (4 * ADC_FRAME_BYTES)
+
+// Global instance
+AdcSampler adcSampler;
+
+// AdcSampler Implementation
+AdcSampler::AdcSampler()
+    : characterized(false), lastCaptureUs(0), droppedFrames(0) {
+}
+
+bool AdcSampler::capture(int pin, uint16_t* out, size_t count, unsigned long timeoutMs) {
+    int8_t channel = digitalPinToAnalogChannel(pin);
+    if (channel < 0 || channel >= SOC_ADC_CHANNEL_NUM(0)) {
+        Serial.printf("ADC: pin %d is not an ADC1 pin\n", pin);
+        return false;
+    }
+
+    adc_digi_init_config_t initConfig = {};
+    initConfig.max_store_buf_size = ADC_DMA_BUFFER_BYTES;
+    initConfig.conv_num_each_intr = ADC_FRAME_BYTES;
+    initConfig.adc1_chan_mask = BIT(channel);
+    initConfig.adc2_chan_mask = 0;
+
+    esp_err_t err = adc_digi_initialize(&initConfig);
+    if (err != ESP_OK) {
+        Serial.printf("ADC: continuous driver install failed: %s\n", esp_err_to_name(err));
+        return false;
+    }
+
+    adc_digi_pattern_config_t pattern = {};
+    pattern.atten = ADC_ATTEN_DB_11;    // ~0-3.1 V, covers the probe front-ends
+    pattern.channel = channel;
+    pattern.unit = 0;                   // ADC1
+    pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+    adc_digi_configuration_t digitalConfig = {};
+    digitalConfig.conv_limit_en = false;
+    digitalConfig.pattern_num = 1;
+    digitalConfig.adc_pattern = &pattern;
+    digitalConfig.sample_freq_hz = ADC_SAMPLE_RATE_HZ;
+    digitalConfig.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    digitalConfig.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+
+    err = adc_digi_controller_configure(&digitalConfig);
+    if (err == ESP_OK) {
+        err = adc_digi_start();
+    }
+    if (err != ESP_OK) {
+        Serial.printf("ADC: continuous mode start failed: %s\n", esp_err_to_name(err));
+        adc_digi_deinitialize();
+        return false;
+    }
+
+    // The CPU only wakes once per completed frame to copy samples out
+    uint8_t frame[ADC_FRAME_BYTES];
+    size_t collected = 0;
+    unsigned long startUs = micros();
+    unsigned long startMs = millis();
+
+    while (collected < count && millis() - startMs < timeoutMs) {
+        uint32_t length = 0;
+        err = adc_digi_read_bytes(frame, sizeof(frame), &length, timeoutMs);
+        if (err == ESP_ERR_INVALID_STATE) {
+            // Driver ring buffer overflowed; the frames that did arrive are still valid
+            droppedFrames++;
+        } else if (err != ESP_OK) {
+            break;
+        }
+
+        for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length && collected < count;
+             i += SOC_ADC_DIGI_RESULT_BYTES) {
+            adc_digi_output_data_t* result = (adc_digi_output_data_t*)&frame[i];
+            if (result->type2.unit == 0 && result->type2.channel == channel) {
+                out[collected++] = result->type2.data;
+            }
+        }
+    }
+
+    lastCaptureUs = micros() - startUs;
+    adc_digi_stop();
+    adc_digi_deinitialize();
+
+    if (collected < count) {
+        Serial.printf("ADC: burst on pin %d incomplete (%u of %u samples)\n",
+                     pin, (unsigned)collected, (unsigned)count);
+        return false;
+    }
+    return true;
+}
+
+float AdcSampler::rawToMillivolts(float raw) {
+    if (!characterized) {
+        esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &characteristics);
+        characterized = true;
+    }
+
+    // The eFuse curve is integer-valued; interpolate to keep the filter's sub-LSB resolution
+    if (raw < 0.0f) {
+        raw = 0.0f;
+    }
+    uint32_t lower = (uint32_t)raw;
+    float fraction = raw - lower;
+    uint32_t lowerMv = esp_adc_cal_raw_to_voltage(lower, &characteristics);
+    uint32_t upperMv = esp_adc_cal_raw_to_voltage(lower + 1, &characteristics);
+    return lowerMv + fraction * ((float)upperMv - (float)lowerMv);
+}
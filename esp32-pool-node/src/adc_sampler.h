@@ -0,0 +1,35 @@
+#ifndef ADC_SAMPLER_H
+#define ADC_SAMPLER_H
+
+#include <Arduino.h>
+#include <esp_adc_cal.h>
+
+// Burst capture on the ESP32-S3 ADC continuous (DMA) mode.
+// The digital controller fills DMA frames at ADC_SAMPLE_RATE_HZ without CPU
+// involvement; capture() only copies finished frames out of the driver's
+// ring buffer. The driver is installed per burst and removed afterwards, so
+// it costs nothing while the node sleeps. Only ADC1 pins can be used: ADC2
+// is shared with the WiFi radio.
+class AdcSampler {
+public:
+    AdcSampler();
+
+    // Fills `out` with `count` 12-bit samples from `pin`
+    bool capture(int pin, uint16_t* out, size_t count, unsigned long timeoutMs);
+
+    // Converts a (fractional) raw reading to millivolts using the eFuse calibration
+    float rawToMillivolts(float raw);
+
+    unsigned long getLastCaptureUs() const { return lastCaptureUs; }
+    unsigned long getDroppedFrames() const { return droppedFrames; }
+
+private:
+    esp_adc_cal_characteristics_t characteristics;
+    bool characterized;
+    unsigned long lastCaptureUs;
+    unsigned long droppedFrames;
+};
+
+extern AdcSampler adcSampler;
+
+#endif
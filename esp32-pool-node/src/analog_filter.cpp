@@ -0,0 +1,127 @@
+#include "analog_filter.h"
+#include <math.h>
+#include <algorithm>
+
+#if defined(ESP_PLATFORM) && __has_include(<esp_dsp.h>)
+#include <esp_dsp.h>
+#define ANALOG_FILTER_USE_ESP_DSP 1
+#else
+#define ANALOG_FILTER_USE_ESP_DSP 0
+#endif
+
+static float dotProduct(const float* a, const float* b, int length) {
+#if ANALOG_FILTER_USE_ESP_DSP
+    float result = 0.0f;
+    dsps_dotprod_f32(a, b, &result, length);
+    return result;
+#else
+    float result = 0.0f;
+    for (int i = 0; i < length; i++) {
+        result += a[i] * b[i];
+    }
+    return result;
+#endif
+}
+
+// AnalogFilterChain Implementation
+AnalogFilterChain::AnalogFilterChain(int taps, int decimation, int trimPercent, float cutoff)
+    : taps(std::min(std::max(taps, 1), ANALOG_FIR_MAX_TAPS)),
+      decimation(std::max(decimation, 1)),
+      trimPercent(std::min(std::max(trimPercent, 0), 45)) {
+    // Hamming-windowed sinc low-pass with its corner below the decimated Nyquist rate.
+    // The kernel is symmetric, so correlation and convolution are the same operation.
+    const float fc = cutoff * 0.5f / this->decimation;
+    const float center = (this->taps - 1) / 2.0f;
+    float sum = 0.0f;
+
+    for (int n = 0; n < this->taps; n++) {
+        float x = n - center;
+        float sinc = (x == 0.0f) ? 2.0f * fc : sinf(2.0f * (float)M_PI * fc * x) / ((float)M_PI * x);
+        float window = (this->taps > 1) ? 0.54f - 0.46f * cosf(2.0f * (float)M_PI * n / (this->taps - 1)) : 1.0f;
+        coeffs[n] = sinc * window;
+        sum += coeffs[n];
+    }
+
+    // Unity gain at DC so the output stays in ADC counts
+    for (int n = 0; n < this->taps; n++) {
+        coeffs[n] /= sum;
+    }
+}
+
+bool AnalogFilterChain::process(const uint16_t* raw, size_t count, float* work, float* decimated,
+                                AnalogFilterResult& result) const {
+    size_t outputCount = decimatedLength(count);
+    if (outputCount == 0) {
+        return false;
+    }
+
+    result.minRaw = UINT16_MAX;
+    result.maxRaw = 0;
+    for (size_t i = 0; i < count; i++) {
+        result.minRaw = std::min(result.minRaw, raw[i]);
+        result.maxRaw = std::max(result.maxRaw, raw[i]);
+    }
+
+    convert(raw, count, work);
+    result.decimatedCount = decimate(work, count, decimated);
+    result.value = trimmedMean(decimated, result.decimatedCount, &result.noise);
+    return true;
+}
+
+void AnalogFilterChain::convert(const uint16_t* raw, size_t count, float* out) const {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = raw[i];
+    }
+}
+
+size_t AnalogFilterChain::decimate(const float* in, size_t count, float* out) const {
+    // Only fully overlapped outputs are produced, so there is no start-up transient
+    size_t produced = 0;
+    for (size_t start = 0; start + taps <= count; start += decimation) {
+        out[produced++] = dotProduct(in + start, coeffs, taps);
+    }
+    return produced;
+}
+
+float AnalogFilterChain::trimmedMean(float* samples, size_t count, float* noise) const {
+    if (count == 0) {
+        if (noise) *noise = 0.0f;
+        return 0.0f;
+    }
+
+    // Sorting in place drops spikes from either end before averaging
+    std::sort(samples, samples + count);
+    size_t trim = count * trimPercent / 100;
+    size_t kept = count - 2 * trim;
+
+    double sum = 0.0;
+    for (size_t i = trim; i < count - trim; i++) {
+        sum += samples[i];
+    }
+    float mean = sum / kept;
+
+    if (noise) {
+        double variance = 0.0;
+        for (size_t i = trim; i < count - trim; i++) {
+            double delta = samples[i] - mean;
+            variance += delta * delta;
+        }
+        *noise = sqrt(variance / kept);
+    }
+    return mean;
+}
+
+size_t AnalogFilterChain::decimatedLength(size_t count) const {
+    if (count < (size_t)taps) {
+        return 0;
+    }
+    return (count - taps) / decimation + 1;
+}
+
+const char* AnalogFilterChain::getKernelName() {
+#if ANALOG_FILTER_USE_ESP_DSP
+    return "esp-dsp";
+#else
+    return "portable";
+#endif
+}
@@ -0,0 +1,50 @@
+#ifndef ANALOG_FILTER_H
+#define ANALOG_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Filter chain for ADC sample bursts from the analog probes:
+//   raw counts -> float -> low-pass FIR + decimation -> trimmed mean
+// Plain C++ with no Arduino dependencies so the same code runs in the host
+// benchmark (bench/analog_filter_bench.cpp). On the ESP32 the FIR inner loop
+// uses the esp-dsp dot product kernel (SIMD on the S3); elsewhere it falls
+// back to a portable loop with identical results.
+#define ANALOG_FIR_MAX_TAPS 64
+
+struct AnalogFilterResult {
+    float value;          // Filtered level in raw ADC counts (fractional)
+    float noise;          // Standard deviation of the kept decimated samples
+    size_t decimatedCount;
+    uint16_t minRaw;
+    uint16_t maxRaw;
+};
+
+class AnalogFilterChain {
+public:
+    // `cutoff` is the FIR corner as a fraction of the decimated Nyquist rate
+    AnalogFilterChain(int taps, int decimation, int trimPercent, float cutoff = 0.8f);
+
+    // Full chain. `work` must hold `count` floats and `decimated` must hold
+    // decimatedLength(count) floats. Returns false if the burst is too short.
+    bool process(const uint16_t* raw, size_t count, float* work, float* decimated,
+                 AnalogFilterResult& result) const;
+
+    // Individual stages, exposed for the host benchmark
+    void convert(const uint16_t* raw, size_t count, float* out) const;
+    size_t decimate(const float* in, size_t count, float* out) const;
+    float trimmedMean(float* samples, size_t count, float* noise) const;
+
+    size_t decimatedLength(size_t count) const;
+    int getTaps() const { return taps; }
+    int getDecimation() const { return decimation; }
+    static const char* getKernelName();
+
+private:
+    float coeffs[ANALOG_FIR_MAX_TAPS];
+    int taps;
+    int decimation;
+    int trimPercent;
+};
+
+#endif
@@ -0,0 +1,197 @@
+#include "analog_sensors.h"
+#include "analog_filter.h"
+#include "adc_sampler.h"
+#include "config.h"
+#include "json_arena.h"
+#include "power_manager.h"
+#include <Preferences.h>
+#include <math.h>
+
+// Default curves until a probe is calibrated on site (see README)
+static const ProbeCalibration PH_DEFAULT_CALIBRATION = {
+    PROBE_CAL_VERSION, 2, {1500.0f, 2030.0f}, {7.0f, 4.0f}    // ~-59 mV/pH x3 gain, 1.5 V at pH 7
+};
+static const ProbeCalibration ORP_DEFAULT_CALIBRATION = {
+    PROBE_CAL_VERSION, 2, {500.0f, 2500.0f}, {-1000.0f, 1000.0f}  // Unity gain, 1.5 V bias
+};
+static const ProbeCalibration PRESSURE_DEFAULT_CALIBRATION = {
+    PROBE_CAL_VERSION, 2, {333.0f, 3000.0f}, {0.0f, 352.0f}   // 0.5-4.5 V, 0-5 psi, 2:3 divider
+};
+
+// Probes are read one at a time, so they share one set of burst buffers
+static uint16_t rawBurst[ADC_BURST_SAMPLES];
+alignas(16) static float workBuffer[ADC_BURST_SAMPLES];
+alignas(16) static float decimatedBuffer[ADC_BURST_SAMPLES / ADC_DECIMATION + 1];
+static const AnalogFilterChain probeFilter(ADC_FIR_TAPS, ADC_DECIMATION, ADC_TRIM_PERCENT);
+
+#ifdef ADC_TRACE_DUMP
+// One line per burst for the host benchmark: ADCTRACE <id> <rate_hz> <count> v0,v1,...
+static void dumpTrace(const String& id, const uint16_t* raw, size_t count) {
+    Serial.printf("ADCTRACE %s %d %u ", id.c_str(), ADC_SAMPLE_RATE_HZ, (unsigned)count);
+    for (size_t i = 0; i < count; i++) {
+        Serial.print(raw[i]);
+        Serial.print(i + 1 < count ? ',' : '\n');
+    }
+}
+#endif
+
+// AnalogProbeSensor Implementation
+AnalogProbeSensor::AnalogProbeSensor(const String& id, int pin, const ProbeCalibration& defaultCalibration)
+    : probePin(pin), calibration(defaultCalibration), calibrationFromNvs(false), lastValue(0.0) {
+    sensorId = id;
+}
+
+bool AnalogProbeSensor::initialize() {
+    calibrationFromNvs = loadCalibration();
+
+    // A test burst confirms the pin is on ADC1 and the DMA driver can run
+    initialized = adcSampler.capture(probePin, rawBurst, ADC_BURST_SAMPLES, ADC_CAPTURE_TIMEOUT_MS);
+
+    Serial.printf("Analog probe %s initialized on pin %d: %s (%s calibration, %s filter)\n",
+                 sensorId.c_str(), probePin, initialized ? "OK" : "FAILED",
+                 calibrationFromNvs ? "stored" : "default", AnalogFilterChain::getKernelName());
+
+    return initialized;
+}
+
+JsonDocument AnalogProbeSensor::readData() {
+    JsonDocument doc(&jsonArena);
+
+    doc["sensor_id"] = sensorId;
+    doc["sensor_type"] = getType();
+    doc["timestamp"] = millis();
+    doc["units"] = getUnits();
+
+    if (!initialized) {
+        doc["error"] = "Sensor not initialized";
+        return doc;
+    }
+
+    // DMA capture runs at the acquire clock; only the filter chain is boosted
+    AnalogFilterResult result;
+    bool filtered = adcSampler.capture(probePin, rawBurst, ADC_BURST_SAMPLES, ADC_CAPTURE_TIMEOUT_MS);
+    if (filtered) {
+        CpuBoost boost;
+        filtered = probeFilter.process(rawBurst, ADC_BURST_SAMPLES, workBuffer, decimatedBuffer, result);
+    }
+    if (!filtered) {
+        doc["value"] = lastValue;
+        doc["quality"] = "questionable";
+        doc["error"] = "ADC capture failed, using last known value";
+        return doc;
+    }
+
+#ifdef ADC_TRACE_DUMP
+    dumpTrace(sensorId, rawBurst, ADC_BURST_SAMPLES);
+#endif
+
+    float millivolts = adcSampler.rawToMillivolts(result.value);
+    float value = applyCalibration(millivolts);
+
+    doc["value"] = value;
+    doc["millivolts"] = millivolts;
+    doc["noise_counts"] = result.noise;
+    doc["calibrated"] = calibrationFromNvs;
+
+    // A railed input means a disconnected probe or a saturated front-end
+    if (result.minRaw <= ADC_RAIL_MARGIN || result.maxRaw >= 4095 - ADC_RAIL_MARGIN) {
+        doc["quality"] = "out_of_range";
+        doc["error"] = "ADC input at rail, check probe connection";
+    } else if (result.noise > ADC_NOISE_LIMIT_COUNTS) {
+        doc["quality"] = "questionable";
+        doc["error"] = "Excessive signal noise";
+    } else {
+        doc["quality"] = "good";
+        lastValue = value;
+    }
+
+    return doc;
+}
+
+bool AnalogProbeSensor::isAvailable() const {
+    return initialized;
+}
+
+bool AnalogProbeSensor::setCalibration(const ProbeCalibration& newCalibration) {
+    if (!validateCalibration(newCalibration)) {
+        Serial.printf("Analog probe %s: rejected invalid calibration\n", sensorId.c_str());
+        return false;
+    }
+
+    Preferences preferences;
+    if (!preferences.begin("probe_cal", false)) {
+        return false;
+    }
+    bool saved = preferences.putBytes(sensorId.c_str(), &newCalibration, sizeof(newCalibration)) == sizeof(newCalibration);
+    preferences.end();
+
+    if (saved) {
+        calibration = newCalibration;
+        calibrationFromNvs = true;
+        Serial.printf("Analog probe %s: stored %d-point calibration\n", sensorId.c_str(), newCalibration.pointCount);
+    }
+    return saved;
+}
+
+bool AnalogProbeSensor::loadCalibration() {
+    Preferences preferences;
+    if (!preferences.begin("probe_cal", true)) {
+        return false;
+    }
+
+    ProbeCalibration stored;
+    bool loaded = preferences.getBytesLength(sensorId.c_str()) == sizeof(stored) &&
+                  preferences.getBytes(sensorId.c_str(), &stored, sizeof(stored)) == sizeof(stored) &&
+                  validateCalibration(stored);
+    preferences.end();
+
+    if (loaded) {
+        calibration = stored;
+    }
+    return loaded;
+}
+
+float AnalogProbeSensor::applyCalibration(float millivolts) const {
+    // Find the segment containing the reading; the end segments extrapolate
+    int segment = 0;
+    while (segment < calibration.pointCount - 2 && millivolts > calibration.millivolts[segment + 1]) {
+        segment++;
+    }
+
+    float x0 = calibration.millivolts[segment];
+    float x1 = calibration.millivolts[segment + 1];
+    float y0 = calibration.values[segment];
+    float y1 = calibration.values[segment + 1];
+    return y0 + (millivolts - x0) * (y1 - y0) / (x1 - x0);
+}
+
+bool AnalogProbeSensor::validateCalibration(const ProbeCalibration& candidate) {
+    if (candidate.version != PROBE_CAL_VERSION ||
+        candidate.pointCount < 2 || candidate.pointCount > PROBE_CAL_MAX_POINTS) {
+        return false;
+    }
+    for (int i = 0; i < candidate.pointCount; i++) {
+        if (!isfinite(candidate.millivolts[i]) || !isfinite(candidate.values[i])) {
+            return false;
+        }
+        if (i > 0 && !(candidate.millivolts[i] > candidate.millivolts[i - 1])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// PhSensor Implementation
+PhSensor::PhSensor(const String& id, int pin)
+    : AnalogProbeSensor(id, pin, PH_DEFAULT_CALIBRATION) {
+}
+
+// OrpSensor Implementation
+OrpSensor::OrpSensor(const String& id, int pin)
+    : AnalogProbeSensor(id, pin, ORP_DEFAULT_CALIBRATION) {
+}
+
+// PressureLevelSensor Implementation
+PressureLevelSensor::PressureLevelSensor(const String& id, int pin)
+    : AnalogProbeSensor(id, pin, PRESSURE_DEFAULT_CALIBRATION) {
+}
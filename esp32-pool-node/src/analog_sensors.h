@@ -0,0 +1,73 @@
+#ifndef ANALOG_SENSORS_H
+#define ANALOG_SENSORS_H
+
+#include "sensors.h"
+
+#define PROBE_CAL_MAX_POINTS 4
+#define PROBE_CAL_VERSION 1
+
+// Piecewise-linear probe curve: front-end millivolts -> engineering units.
+// Stored as a blob in NVS (namespace "probe_cal", key = sensor ID).
+struct ProbeCalibration {
+    uint8_t version;
+    uint8_t pointCount;
+    float millivolts[PROBE_CAL_MAX_POINTS];  // Strictly ascending
+    float values[PROBE_CAL_MAX_POINTS];
+};
+
+// Base class for analog probes sampled through the ADC DMA pipeline.
+// Each read captures a burst (adc_sampler.cpp), filters and decimates it
+// (analog_filter.cpp), converts to millivolts with the eFuse ADC calibration
+// and then applies the probe's own calibration curve.
+class AnalogProbeSensor : public PoolSensor {
+public:
+    AnalogProbeSensor(const String& id, int pin, const ProbeCalibration& defaultCalibration);
+
+    bool initialize() override;
+    String getId() const override { return sensorId; }
+    JsonDocument readData() override;
+    bool isAvailable() const override;
+
+    // Validates, applies and persists a new curve
+    bool setCalibration(const ProbeCalibration& calibration);
+    const ProbeCalibration& getCalibration() const { return calibration; }
+
+protected:
+    int probePin;
+    ProbeCalibration calibration;
+    bool calibrationFromNvs;
+    float lastValue;
+
+    bool loadCalibration();
+    float applyCalibration(float millivolts) const;
+    static bool validateCalibration(const ProbeCalibration& calibration);
+};
+
+// pH probe behind a buffered amplifier board
+class PhSensor : public AnalogProbeSensor {
+public:
+    PhSensor(const String& id, int pin);
+
+    String getType() const override { return "ph"; }
+    String getUnits() const override { return "ph"; }
+};
+
+// ORP (oxidation-reduction potential) probe
+class OrpSensor : public AnalogProbeSensor {
+public:
+    OrpSensor(const String& id, int pin);
+
+    String getType() const override { return "orp"; }
+    String getUnits() const override { return "millivolts"; }
+};
+
+// Submersible pressure transducer used as a continuous water level gauge
+class PressureLevelSensor : public AnalogProbeSensor {
+public:
+    PressureLevelSensor(const String& id, int pin);
+
+    String getType() const override { return "water_depth"; }
+    String getUnits() const override { return "centimeters"; }
+};
+
+#endif
@@ -0,0 +1,337 @@
+#include "benchmark.h"
+#include "config.h"
+#include "json_arena.h"
+#include "payloads.h"
+#include "reading_buffer.h"
+#include "sensors.h"
+#include "series_codec.h"
+#include <ArduinoJson.h>
+#include <stdlib.h>
+
+#if defined(ESP_PLATFORM)
+#define BENCH_TARGET "esp32s3"
+#define benchPrintf Serial.printf
+static inline uint32_t readClock() { return ESP.getCycleCount(); }
+static uint32_t clockMhz() { return getCpuFrequencyMhz(); }
+#else
+// Host build (bench/payload_bench.cpp): a nanosecond clock reported as a 1000 MHz CPU
+#include <chrono>
+#include <stdio.h>
+#define BENCH_TARGET "host"
+#define benchPrintf printf
+static inline uint32_t readClock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static uint32_t clockMhz() { return 1000; }
+#endif
+
+// Counts every allocation ArduinoJson makes for a document
+class CountingAllocator : public ArduinoJson::Allocator {
+public:
+    void* allocate(size_t size) override {
+        allocations++;
+        allocatedBytes += size;
+        return malloc(size);
+    }
+
+    void deallocate(void* ptr) override {
+        free(ptr);
+    }
+
+    void* reallocate(void* ptr, size_t newSize) override {
+        allocations++;
+        allocatedBytes += newSize;
+        return realloc(ptr, newSize);
+    }
+
+    void reset() {
+        allocations = 0;
+        allocatedBytes = 0;
+    }
+
+    unsigned long allocations = 0;
+    unsigned long allocatedBytes = 0;
+};
+
+// Where a case allocates outside benchAllocator (String growth, the JSON arena),
+// the allocation columns are reported as null rather than an undercount
+enum AllocTracking {
+    ALLOCS_COUNTED,
+    ALLOCS_UNTRACKED
+};
+
+struct BenchResult {
+    uint32_t minCycles;
+    uint64_t totalCycles;
+    size_t bytes;
+    unsigned long allocations;
+    unsigned long allocatedBytes;
+};
+
+static CountingAllocator benchAllocator;
+
+// Documents are built by the same code as on the node: TemperatureSensor::buildReading()
+// is readData() without the bus I/O, and payloads.cpp builds the gateway and history
+// messages for main.cpp. Only the inputs below are fixed.
+static TemperatureSensor benchSensor("temp_01", TEMP_SENSOR_PIN);
+
+static void buildTemperatureReading(JsonDocument& doc) {
+    benchSensor.buildReading(doc, 78.0125f);
+    doc["seq"] = 4247;
+}
+
+static void buildGateway(JsonDocument& doc, const JsonDocument& reading, const JsonDocument& battery) {
+    GatewayStatus status;
+    status.sequence = 4247;
+    status.sequenceEpoch = 4160;
+    status.configRevision = 3;
+    status.freeHeap = 264480;
+    status.wifiRssi = -66;
+    status.connectionStatus = "Connected";
+    status.tlsHandshakeMs = 0;
+    status.tlsResumed = false;
+    status.temperatureAvailable = true;
+    status.waterLevelAvailable = true;
+    status.batteryAvailable = true;
+    buildGatewayMessage(doc, status, reading, battery);
+}
+
+static void buildBatteryReading(JsonDocument& doc) {
+    doc["value"] = 3.92f;
+    doc["percentage"] = 81;
+}
+
+// A full RTC buffer of 5-minute readings: slow temperature drift, battery
+// discharge, one water-level change and one missed battery read
+static void buildHistory(BufferedReading* readings, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        BufferedReading& reading = readings[i];
+        reading.sequence = 4200 + i;
+        reading.timestampS = 86400 + i * DEFAULT_SLEEP_DURATION_S + (i % 7 == 3 ? 1 : 0);
+        reading.temperatureCentiF = 7800 + (int16_t)(i * 3) - (int16_t)((i * 37) % 11);
+        reading.batteryMv = 3920 - i * 2 + (i * 13) % 5;
+        reading.batteryPercent = 81 - i / 12;
+        reading.flags = READING_HAS_TEMPERATURE | READING_HAS_WATER_LEVEL | READING_HAS_BATTERY;
+        if (i < count / 2) {
+            reading.flags |= READING_WATER_OK;
+        }
+        if (i == count / 3) {
+            reading.flags &= ~READING_HAS_BATTERY;
+        }
+    }
+}
+
+// Same batches as publishBufferedReadings() with HISTORY_FORMAT_JSON
+static size_t serializeHistoryJson(const BufferedReading* readings, size_t count, char* buffer, size_t size) {
+    size_t total = 0;
+    for (size_t start = 0; start < count; start += HISTORY_BATCH_SIZE) {
+        JsonDocument history(&jsonArena);
+        JsonArray entries = beginHistoryMessage(history, readings[count - 1].timestampS);
+        for (size_t i = start; i < count && i < start + HISTORY_BATCH_SIZE; i++) {
+            addHistoryEntry(entries, readings[i]);
+        }
+        total += serializeJson(history, buffer, size);
+    }
+    return total;
+}
+
+static size_t encodeHistorySeries(const BufferedReading* readings, size_t count, uint8_t encoding,
+                                  uint8_t* block, size_t size, uint16_t* encoded) {
+    SeriesEncoder encoder;
+    encoder.begin(block, size, encoding);
+    for (size_t i = 0; i < count; i++) {
+        if (!encoder.append(toSeriesSample(readings[i]))) {
+            break;
+        }
+    }
+    *encoded = encoder.getCount();
+    return encoder.finish(readings[count - 1].timestampS);
+}
+
+// Same shape as a mailbox update
+static const char CONFIG_MESSAGE[] = "{\"rev\":4,\"sleep_duration\":600,\"log_level\":2}";
+
+static void report(const char* name, int iterations, AllocTracking tracking, const BenchResult& result) {
+    uint32_t cpuMhz = clockMhz();
+    uint64_t avgCycles = result.totalCycles / iterations;
+    uint64_t avgNs = avgCycles * 1000 / cpuMhz;
+
+    char allocs[48];
+    if (tracking == ALLOCS_COUNTED) {
+        snprintf(allocs, sizeof(allocs), "\"allocs\":%lu,\"alloc_bytes\":%lu",
+                 result.allocations / iterations, result.allocatedBytes / iterations);
+    } else {
+        snprintf(allocs, sizeof(allocs), "\"allocs\":null,\"alloc_bytes\":null");
+    }
+
+    benchPrintf("BENCH {\"fw\":\"%s\",\"target\":\"%s\",\"name\":\"%s\",\"iterations\":%d,\"cpu_mhz\":%u,"
+                "\"cycles_min\":%u,\"cycles_avg\":%lu,\"ns_avg\":%lu,\"bytes\":%u,%s}\n",
+                FIRMWARE_VERSION, BENCH_TARGET, name, iterations, (unsigned)cpuMhz,
+                (unsigned)result.minCycles, (unsigned long)avgCycles, (unsigned long)avgNs,
+                (unsigned)result.bytes, allocs);
+}
+
+// Time one path; `body` returns the bytes it produced (payload or arena usage)
+template <typename Body>
+static void measure(const char* name, int iterations, AllocTracking tracking, Body body) {
+    BenchResult result = {UINT32_MAX, 0, 0, 0, 0};
+    benchAllocator.reset();
+
+    for (int i = 0; i < iterations; i++) {
+        uint32_t start = readClock();
+        result.bytes = body();
+        uint32_t cycles = readClock() - start;
+
+        result.totalCycles += cycles;
+        if (cycles < result.minCycles) {
+            result.minCycles = cycles;
+        }
+    }
+
+    result.allocations = benchAllocator.allocations;
+    result.allocatedBytes = benchAllocator.allocatedBytes;
+    report(name, iterations, tracking, result);
+}
+
+void runPayloadBenchmarks(int iterations) {
+    benchPrintf("Running payload benchmarks (%d iterations)...\n", iterations);
+
+    // readData() document construction
+    measure("reading_build", iterations, ALLOCS_COUNTED, []() {
+        JsonDocument doc(&benchAllocator);
+        buildTemperatureReading(doc);
+        return (size_t)0;
+    });
+
+    measure("reading_build_arena", iterations, ALLOCS_UNTRACKED, []() {
+        // Arena bytes held by this document; the high-water mark spans every case
+        size_t start = jsonArena.getUsed();
+        JsonDocument doc(&jsonArena);
+        buildTemperatureReading(doc);
+        return jsonArena.getUsed() - start;
+    });
+
+    // publishSensorData() encoders
+    JsonDocument reading;
+    buildTemperatureReading(reading);
+
+    measure("reading_serialize_string", iterations, ALLOCS_UNTRACKED, [&]() {
+        String payload;
+        serializeJson(reading, payload);
+        return (size_t)payload.length();
+    });
+
+    measure("reading_serialize_buffer", iterations, ALLOCS_COUNTED, [&]() {
+        char buffer[MQTT_BUFFER_SIZE];
+        return serializeJson(reading, buffer, sizeof(buffer));
+    });
+
+    measure("reading_serialize_msgpack", iterations, ALLOCS_COUNTED, [&]() {
+        uint8_t buffer[MQTT_BUFFER_SIZE];
+        return serializeMsgPack(reading, buffer, sizeof(buffer));
+    });
+
+    // publishGatewayMessage() assembly and encoding
+    JsonDocument battery;
+    buildBatteryReading(battery);
+
+    measure("gateway_build", iterations, ALLOCS_COUNTED, [&]() {
+        JsonDocument doc(&benchAllocator);
+        buildGateway(doc, reading, battery);
+        return (size_t)0;
+    });
+
+    measure("gateway_build_arena", iterations, ALLOCS_UNTRACKED, [&]() {
+        size_t start = jsonArena.getUsed();
+        JsonDocument doc(&jsonArena);
+        buildGateway(doc, reading, battery);
+        return jsonArena.getUsed() - start;
+    });
+
+    JsonDocument gateway;
+    buildGateway(gateway, reading, battery);
+
+    measure("gateway_serialize_string", iterations, ALLOCS_UNTRACKED, [&]() {
+        String payload;
+        serializeJson(gateway, payload);
+        return (size_t)payload.length();
+    });
+
+    measure("gateway_serialize_msgpack", iterations, ALLOCS_COUNTED, [&]() {
+        uint8_t buffer[MQTT_BUFFER_SIZE];
+        return serializeMsgPack(gateway, buffer, sizeof(buffer));
+    });
+
+    // onMQTTMessage() parse, as written (payload copied into a String first)
+    measure("config_parse_string", iterations, ALLOCS_UNTRACKED, []() {
+        const uint8_t* payload = (const uint8_t*)CONFIG_MESSAGE;
+        unsigned int length = sizeof(CONFIG_MESSAGE) - 1;
+
+        String message;
+        for (unsigned int i = 0; i < length; i++) {
+            message += (char)payload[i];
+        }
+
+        JsonDocument config(&benchAllocator);
+        deserializeJson(config, message);
+        return (size_t)length;
+    });
+
+    // Alternative: parse straight from the MQTT buffer
+    measure("config_parse_direct", iterations, ALLOCS_COUNTED, []() {
+        unsigned int length = sizeof(CONFIG_MESSAGE) - 1;
+
+        JsonDocument config(&benchAllocator);
+        deserializeJson(config, (const uint8_t*)CONFIG_MESSAGE, length);
+        return (size_t)length;
+    });
+
+    // Buffered history upload: JSON batches vs compressed series blocks
+    // (divide cycles by "samples" from the history_compression line for the per-sample cost)
+    static BufferedReading history[READING_BUFFER_CAPACITY];
+    static uint8_t block[SERIES_BLOCK_SIZE];
+    static char jsonBuffer[MQTT_BUFFER_SIZE];
+    buildHistory(history, READING_BUFFER_CAPACITY);
+    uint16_t encoded = 0;
+    
+    size_t jsonBytes = serializeHistoryJson(history, READING_BUFFER_CAPACITY, jsonBuffer, sizeof(jsonBuffer));
+    size_t xorBytes = encodeHistorySeries(history, READING_BUFFER_CAPACITY, SERIES_XOR, block, sizeof(block), &encoded);
+    uint16_t xorEncoded = encoded;
+    size_t seriesBytes = encodeHistorySeries(history, READING_BUFFER_CAPACITY, SERIES_QUANTIZED, block, sizeof(block), &encoded);
+    
+    measure("history_json_serialize", iterations, ALLOCS_UNTRACKED, [&]() {
+        return serializeHistoryJson(history, READING_BUFFER_CAPACITY, jsonBuffer, sizeof(jsonBuffer));
+    });
+    
+    measure("history_series_encode", iterations, ALLOCS_COUNTED, [&]() {
+        return encodeHistorySeries(history, READING_BUFFER_CAPACITY, SERIES_QUANTIZED, block, sizeof(block), &encoded);
+    });
+    
+    measure("history_series_encode_xor", iterations, ALLOCS_COUNTED, [&]() {
+        uint16_t count;
+        return encodeHistorySeries(history, READING_BUFFER_CAPACITY, SERIES_XOR, block, sizeof(block), &count);
+    });
+    
+    encodeHistorySeries(history, READING_BUFFER_CAPACITY, SERIES_QUANTIZED, block, sizeof(block), &encoded);
+    measure("history_series_decode", iterations, ALLOCS_COUNTED, [&]() {
+        SeriesDecoder decoder(block, seriesBytes);
+        SeriesBlockInfo info;
+        SeriesSample sample;
+        size_t decoded = 0;
+        if (decoder.begin(info)) {
+            while (decoder.next(sample)) {
+                decoded++;
+            }
+        }
+        return decoded;
+    });
+    
+    benchPrintf("BENCH {\"fw\":\"%s\",\"target\":\"%s\",\"name\":\"history_compression\",\"samples\":%u,\"xor_samples\":%u,"
+                "\"raw_bytes\":%u,\"json_bytes\":%u,\"series_bytes\":%u,\"xor_bytes\":%u}\n",
+                FIRMWARE_VERSION, BENCH_TARGET, (unsigned)encoded, (unsigned)xorEncoded,
+                (unsigned)(READING_BUFFER_CAPACITY * sizeof(BufferedReading)),
+                (unsigned)jsonBytes, (unsigned)seriesBytes, (unsigned)xorBytes);
+    
+    benchPrintf("Payload benchmarks complete\n");
+}
@@ -0,0 +1,12 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <Arduino.h>
+
+// Microbenchmarks for the payload build, serialize and parse paths, on target
+// (pio run -e benchmark) or on the host (bench/payload_bench.cpp).
+// Each result is printed as a single line "BENCH {json}" so a serial capture
+// can be grepped and diffed between firmware versions.
+void runPayloadBenchmarks(int iterations = 200);
+
+#endif
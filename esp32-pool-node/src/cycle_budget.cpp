@@ -0,0 +1,86 @@
+#include "cycle_budget.h"
+#include "config.h"
+#include <esp_task_wdt.h>
+
+static_assert(BUDGET_ACQUIRE_MS + BUDGET_CONNECT_MS + BUDGET_PUBLISH_MS + BUDGET_DRAIN_MS
+              < WATCHDOG_TIMEOUT_S * 1000UL,
+              "Wake-cycle budgets must fit inside the task watchdog timeout");
+
+static const unsigned long PHASE_BUDGET_MS[PHASE_COUNT] = {
+    BUDGET_ACQUIRE_MS,
+    BUDGET_CONNECT_MS,
+    BUDGET_PUBLISH_MS,
+    BUDGET_DRAIN_MS
+};
+
+static const char* PHASE_NAMES[PHASE_COUNT] = {
+    "acquire",
+    "connect",
+    "publish",
+    "drain"
+};
+
+RTC_DATA_ATTR static uint32_t rtcOverruns[PHASE_COUNT];
+
+CycleBudget cycleBudget;
+
+void CycleBudget::beginPhase(CyclePhase phase) {
+    if (active) {
+        endPhase();
+    }
+
+    esp_task_wdt_reset();
+    current = phase;
+    phaseStart = millis();
+    active = true;
+    if (listener) {
+        listener(phase, true);
+    }
+}
+
+void CycleBudget::endPhase() {
+    if (!active) {
+        return;
+    }
+
+    unsigned long duration = millis() - phaseStart;
+    lastDurationMs[current] = duration;
+    active = false;
+    if (listener) {
+        listener(current, false);
+    }
+
+    if (duration > PHASE_BUDGET_MS[current]) {
+        rtcOverruns[current]++;
+        Serial.printf("Cycle phase %s overran: %lu ms (budget %lu ms)\n",
+                     PHASE_NAMES[current], duration, PHASE_BUDGET_MS[current]);
+    }
+}
+
+bool CycleBudget::expired() const {
+    return active && millis() - phaseStart >= PHASE_BUDGET_MS[current];
+}
+
+unsigned long CycleBudget::remainingMs() const {
+    if (!active) {
+        return 0;
+    }
+    unsigned long elapsed = millis() - phaseStart;
+    return elapsed >= PHASE_BUDGET_MS[current] ? 0 : PHASE_BUDGET_MS[current] - elapsed;
+}
+
+unsigned long CycleBudget::getBudgetMs(CyclePhase phase) const {
+    return PHASE_BUDGET_MS[phase];
+}
+
+unsigned long CycleBudget::getLastDurationMs(CyclePhase phase) const {
+    return lastDurationMs[phase];
+}
+
+unsigned long CycleBudget::getOverrunCount(CyclePhase phase) const {
+    return rtcOverruns[phase];
+}
+
+const char* CycleBudget::getPhaseName(CyclePhase phase) {
+    return PHASE_NAMES[phase];
+}
@@ -0,0 +1,48 @@
+#ifndef CYCLE_BUDGET_H
+#define CYCLE_BUDGET_H
+
+#include <Arduino.h>
+
+enum CyclePhase {
+    PHASE_ACQUIRE,   // Sensor reads
+    PHASE_CONNECT,   // WiFi + MQTT connection
+    PHASE_PUBLISH,   // Live and buffered publishes
+    PHASE_DRAIN,     // Waiting for acks before sleep
+    PHASE_COUNT
+};
+
+// Per-phase time budgets for a wake cycle.
+// Each phase gets a deadline from config.h; long-running loops poll expired()
+// and fall back (shorter sampling, buffer-and-sleep, skip acks) instead of
+// running into the task watchdog. The watchdog is fed at every phase start,
+// and overrun counters live in RTC memory so they survive deep sleep.
+class CycleBudget {
+public:
+    // Called at every phase start and end (e.g. to rescale the CPU clock)
+    typedef void (*PhaseListener)(CyclePhase phase, bool active);
+    void setPhaseListener(PhaseListener listener) { this->listener = listener; }
+
+    void beginPhase(CyclePhase phase);
+    void endPhase();
+
+    // expired() is false when no phase is active, so callers outside a cycle
+    // are unaffected; remainingMs() is 0 in that case
+    bool expired() const;
+    unsigned long remainingMs() const;
+
+    unsigned long getBudgetMs(CyclePhase phase) const;
+    unsigned long getLastDurationMs(CyclePhase phase) const;
+    unsigned long getOverrunCount(CyclePhase phase) const;
+    static const char* getPhaseName(CyclePhase phase);
+
+private:
+    bool active = false;
+    CyclePhase current = PHASE_ACQUIRE;
+    unsigned long phaseStart = 0;
+    unsigned long lastDurationMs[PHASE_COUNT] = {};
+    PhaseListener listener = nullptr;
+};
+
+extern CycleBudget cycleBudget;
+
+#endif
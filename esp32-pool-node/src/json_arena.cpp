@@ -0,0 +1,109 @@
+#include "json_arena.h"
+
+JsonArena jsonArena;
+
+JsonArena::JsonArena()
+    : offset(0), lastBlock(JSON_ARENA_SIZE), liveBlocks(0), peak(0),
+      lastCyclePeak(0), overflows(0), overflowLogged(false) {
+}
+
+void* JsonArena::allocate(size_t size) {
+    size_t span = blockSpan(size);
+    if (offset + span > JSON_ARENA_SIZE) {
+        // Degrade to the heap rather than letting ArduinoJson drop data
+        overflows++;
+        if (!overflowLogged) {
+            Serial.printf("JSON arena full (%u/%u bytes), falling back to heap\n",
+                         (unsigned)offset, JSON_ARENA_SIZE);
+            overflowLogged = true;
+        }
+        return malloc(size);
+    }
+
+    BlockHeader* header = (BlockHeader*)(buffer + offset);
+    header->size = size;
+    lastBlock = offset;
+    offset += span;
+    liveBlocks++;
+
+    if (offset > peak) {
+        peak = offset;
+    }
+    return header + 1;
+}
+
+void JsonArena::deallocate(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    if (!owns(ptr)) {
+        free(ptr);
+        return;
+    }
+
+    liveBlocks--;
+    size_t blockOffset = (uint8_t*)ptr - buffer - sizeof(BlockHeader);
+    if (liveBlocks == 0) {
+        offset = 0;
+        lastBlock = JSON_ARENA_SIZE;
+    } else if (blockOffset == lastBlock) {
+        offset = lastBlock;
+        lastBlock = JSON_ARENA_SIZE;
+    }
+}
+
+void* JsonArena::reallocate(void* ptr, size_t newSize) {
+    if (!ptr) {
+        return allocate(newSize);
+    }
+    if (!owns(ptr)) {
+        return realloc(ptr, newSize);
+    }
+
+    BlockHeader* header = (BlockHeader*)ptr - 1;
+    size_t blockOffset = (uint8_t*)header - buffer;
+
+    // The newest block can grow or shrink in place
+    if (blockOffset == lastBlock && blockOffset + blockSpan(newSize) <= JSON_ARENA_SIZE) {
+        header->size = newSize;
+        offset = blockOffset + blockSpan(newSize);
+        if (offset > peak) {
+            peak = offset;
+        }
+        return ptr;
+    }
+
+    if (newSize <= header->size) {
+        header->size = newSize;
+        return ptr;
+    }
+
+    void* moved = allocate(newSize);
+    if (moved) {
+        memcpy(moved, ptr, header->size);
+        deallocate(ptr);
+    }
+    return moved;
+}
+
+void JsonArena::reset() {
+    if (liveBlocks > 0) {
+        Serial.printf("WARNING: JSON arena reset with %u live blocks, keeping %u bytes\n",
+                     (unsigned)liveBlocks, (unsigned)offset);
+    } else {
+        offset = 0;
+        lastBlock = JSON_ARENA_SIZE;
+    }
+
+    lastCyclePeak = peak;
+    peak = offset;
+    overflowLogged = false;
+}
+
+bool JsonArena::owns(const void* ptr) const {
+    return ptr >= buffer && ptr < buffer + JSON_ARENA_SIZE;
+}
+
+size_t JsonArena::blockSpan(size_t size) {
+    return sizeof(BlockHeader) + ((size + 7) & ~(size_t)7);
+}
@@ -0,0 +1,53 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// Bump allocator for ArduinoJson documents.
+// All per-cycle documents are carved out of a static JSON_ARENA_SIZE buffer
+// instead of the general heap. Freed blocks are only reclaimed when they are
+// the most recent allocation or when every block is gone; reset() starts a
+// new cycle and records its high-water mark. If the arena fills up, blocks
+// fall back to malloc and are counted, so documents are never truncated.
+class JsonArena : public ArduinoJson::Allocator {
+public:
+    JsonArena();
+
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t newSize) override;
+
+    // Call once per wake cycle, before any document is built
+    void reset();
+
+    size_t getCapacity() const { return JSON_ARENA_SIZE; }
+    size_t getUsed() const { return offset; }
+    size_t getHighWaterMark() const { return peak; }
+    size_t getLastCycleHighWaterMark() const { return lastCyclePeak; }
+    unsigned long getOverflowCount() const { return overflows; }
+
+private:
+    // 8-byte header keeps every block 8-byte aligned
+    struct BlockHeader {
+        uint32_t size;
+        uint32_t reserved;
+    };
+
+    alignas(8) uint8_t buffer[JSON_ARENA_SIZE];
+    size_t offset;
+    size_t lastBlock;   // Offset of the most recent header, or JSON_ARENA_SIZE if none
+    size_t liveBlocks;
+    size_t peak;
+    size_t lastCyclePeak;
+    unsigned long overflows;
+    bool overflowLogged;
+
+    bool owns(const void* ptr) const;
+    static size_t blockSpan(size_t size);
+};
+
+extern JsonArena jsonArena;
+
+#endif
@@ -1,9 +1,30 @@
 #include <Arduino.h>
 #include <esp_sleep.h>
 #include <esp_task_wdt.h>
+#include <esp_log.h>
 #include "config.h"
 #include "sensors.h"
 #include "mqtt_client.h"
+#include "json_arena.h"
+#include "cycle_budget.h"
+#include "reading_buffer.h"
+#include "sensor_trace.h"
+#include "sensor_health.h"
+#include "power_manager.h"
+#include "node_config.h"
+#include "payloads.h"
+#if TRACE_SINK == TRACE_SINK_FLASH
+#include <LittleFS.h>
+#endif
+#if ANALOG_PROBES_ENABLED
+#include "analog_sensors.h"
+#endif
+#if NODE_ROLE != NODE_ROLE_STANDALONE
+#include "relay_link.h"
+#endif
+#ifdef RUN_PAYLOAD_BENCHMARKS
+#include "benchmark.h"
+#endif
 
 // Global objects
 PoolMQTTClient mqttClient;
@@ -11,19 +32,71 @@ TemperatureSensor* tempSensor;
 WaterLevelSensor* waterLevelSensor;
 BatterySensor* batterySensor;
 
+#if ANALOG_PROBES_ENABLED
+#define ANALOG_PROBE_COUNT 3
+AnalogProbeSensor* analogProbes[ANALOG_PROBE_COUNT];
+#endif
+
+#if POWER_MODE == POWER_MODE_LIGHT_SLEEP && NODE_ROLE != NODE_ROLE_STANDALONE
+#error "Light-sleep mode is for standalone nodes; ESP-NOW needs the radio on between beacons"
+#endif
+
+#if NODE_ROLE != NODE_ROLE_STANDALONE
+EspNowLink relayLink(NODE_ROLE == NODE_ROLE_GATEWAY);
+#endif
+
 // System state
 unsigned long lastSensorRead = 0;
-unsigned long sleepDuration = DEFAULT_SLEEP_DURATION_S;
 bool systemInitialized = false;
+bool configMailboxRead = false;
+
+#if TRACE_SINK == TRACE_SINK_FLASH
+// Requested trace upload, sent a few slices per loop() from this file offset
+bool traceUploadPending = false;
+size_t traceUploadOffset = 0;
+#endif
+
+#if NODE_ROLE == NODE_ROLE_LEAF
+// Leaf state kept across deep sleep
+RTC_DATA_ATTR uint16_t leafRadioMs = 0;
+#endif
+
+// Last command served from the retained command topic, which is read again on every wake
+RTC_DATA_ATTR uint32_t lastCommandId = 0;
 
 // Function declarations
 void setupSensors();
+bool initializeSensor(PoolSensor* sensor);
+JsonDocument readSensor(PoolSensor* sensor);
 void setupMQTT();
+void subscribeConfigTopics();
+void applyConfigMailbox(JsonObjectConst mailbox);
+void handleCommand(JsonObjectConst command);
+void applySettings();
 void readAndPublishSensors();
-void publishGatewayMessage();
+bool publishWithinBudget(const char* topic, const JsonDocument& data);
+void publishBufferedReadings();
+BufferedReading summarizeReadings(uint32_t sequence, const JsonDocument& tempData, const JsonDocument& levelData,
+                                  const JsonDocument& batteryData);
+bool publishBackfill(uint32_t commandId, uint32_t from, uint32_t to);
+bool addHistoryEntryWithin(JsonDocument& history, JsonArray readings, const BufferedReading& reading);
+bool publishGatewayMessage(uint32_t sequence, const JsonDocument& tempData, const JsonDocument& batteryData);
 void enterDeepSleep();
+#if NODE_ROLE == NODE_ROLE_LEAF
+void runLeafCycle();
+#elif NODE_ROLE == NODE_ROLE_GATEWAY
+void relayLeafReadings();
+#endif
 void onMQTTMessage(char* topic, uint8_t* payload, unsigned int length);
+void flushSensorTrace();
+#if TRACE_SINK == TRACE_SINK_FLASH
+bool appendTraceToFlash(const uint8_t* data, size_t length);
+void serviceTraceUpload();
+#endif
 void setupWatchdog();
+#if ANALOG_PROBES_ENABLED
+void applyProbeCalibration(JsonObjectConst request);
+#endif
 void blinkLED(int times, int delayMs = 200);
 
 void setup() {
@@ -49,17 +122,49 @@ void setup() {
     
     blinkLED(3, 500); // Slower startup indicator
     
+#ifdef RUN_PAYLOAD_BENCHMARKS
+    // Run before the watchdog is armed; a full run takes a few seconds
+    runPayloadBenchmarks();
+#endif
+    
+    // I/O-bound phases run at a lower clock from here on (benchmarks above run at full speed)
+    powerManager.beginFrequencyScaling();
+    
     // Setup watchdog timer
     setupWatchdog();
     
+    // Settings from the last mailbox update, or the config.h defaults
+    nodeConfig.begin();
+    
     // Initialize sensors
+    cycleBudget.beginPhase(PHASE_ACQUIRE);
+    sensorTrace.startCycle(getNodeClockS());
     setupSensors();
+    cycleBudget.endPhase();
+    
+#if NODE_ROLE == NODE_ROLE_LEAF
+    // Leaf nodes never join WiFi: read, send over ESP-NOW, deep sleep
+    runLeafCycle();
+#endif
     
     // Initialize MQTT
+    cycleBudget.beginPhase(PHASE_CONNECT);
     setupMQTT();
     
-    // Subscribe to configuration topic
-    mqttClient.subscribe(TOPIC_CONFIG);
+    // Subscribe to configuration topics and pick up the mailbox before the first reading
+    subscribeConfigTopics();
+    cycleBudget.endPhase();
+    
+#if POWER_MODE == POWER_MODE_LIGHT_SLEEP
+    // WiFi and MQTT stay up; the CPU light-sleeps between DTIM beacons
+    powerManager.beginLightSleep();
+#endif
+    
+#if NODE_ROLE == NODE_ROLE_GATEWAY
+    if (!relayLink.begin()) {
+        Serial.println("WARNING: ESP-NOW relay initialization failed");
+    }
+#endif
     
     systemInitialized = true;
     Serial.println("=== System initialization complete ===\n");
@@ -75,65 +180,165 @@ void loop() {
     if (now - lastHeartbeat >= 5000) {
         lastHeartbeat = now;
         Serial.printf("Heartbeat: %lu ms, Free heap: %d\n", now, ESP.getFreeHeap());
+#if POWER_MODE != POWER_MODE_LIGHT_SLEEP
         blinkLED(1, 50); // Quick heartbeat blink
+#endif
+    }
+    
+    // Maintain MQTT connection; only actual reconnect attempts run (and are
+    // timed) as a connect phase
+    if (mqttClient.shouldReconnect()) {
+        cycleBudget.beginPhase(PHASE_CONNECT);
+        if (mqttClient.reconnect()) {
+            subscribeConfigTopics();
+        }
+        cycleBudget.endPhase();
+    } else {
+        mqttClient.loop();
     }
     
-    // Maintain MQTT connection
-    mqttClient.loop();
+#if NODE_ROLE == NODE_ROLE_GATEWAY
+    relayLeafReadings();
+#endif
     
+#if TRACE_SINK == TRACE_SINK_FLASH
+    serviceTraceUpload();
+#endif
+    
+#if POWER_MODE == POWER_MODE_LIGHT_SLEEP
+    // Same reporting interval as deep sleep, without reconnecting every cycle
+    unsigned long readIntervalMs = nodeConfig.get().sleepDurationS * 1000UL;
+#else
     // Read and publish sensor data every 20 seconds for testing
-    if (systemInitialized && mqttClient.isConnected() && (now - lastSensorRead >= 20000)) {
+    unsigned long readIntervalMs = 20000;
+#endif
+    
+    // Readings taken while disconnected are buffered for the next cycle
+    if (systemInitialized && (now - lastSensorRead >= readIntervalMs)) {
         lastSensorRead = now;
         readAndPublishSensors();
         
-        Serial.println("Waiting 20 seconds before next sensor reading...");
+        Serial.printf("Waiting %lu seconds before next sensor reading...\n", readIntervalMs / 1000);
     }
     
+#if POWER_MODE == POWER_MODE_LIGHT_SLEEP
+    // Block on the MQTT socket so the idle task can light-sleep until a
+    // packet arrives, the next reading is due or the loop must run again
+    unsigned long untilNextRead = readIntervalMs - (millis() - lastSensorRead);
+    if (untilNextRead > readIntervalMs) {
+        untilNextRead = 0;
+    }
+#if TRACE_SINK == TRACE_SINK_FLASH
+    if (traceUploadPending) {
+        untilNextRead = 0; // Keep a trace upload moving
+    }
+#endif
+    powerManager.idle(mqttClient, min(untilNextRead, (unsigned long)LIGHT_SLEEP_MAX_IDLE_MS));
+#else
     delay(1000);
+#endif
 }
 
 void setupSensors() {
     Serial.println("Initializing sensors...");
     
-    // Initialize temperature sensor
     tempSensor = new TemperatureSensor("temp_01", TEMP_SENSOR_PIN);
-    if (!tempSensor->initialize()) {
+    waterLevelSensor = new WaterLevelSensor("water_level_01", 
+                                           FLOAT_SWITCH_PIN_1, 
+                                           FLOAT_SWITCH_PIN_2);
+    batterySensor = new BatterySensor("battery_01", BATTERY_ADC_PIN);
+    
+    // Stored retries, sample counts, thresholds and breaker policy apply from the first init
+    applySettings();
+    
+    // Initialize temperature sensor
+    if (!initializeSensor(tempSensor)) {
         Serial.println("WARNING: Temperature sensor initialization failed");
     }
     
     // Initialize water level sensor
-    waterLevelSensor = new WaterLevelSensor("water_level_01", 
-                                           FLOAT_SWITCH_PIN_1, 
-                                           FLOAT_SWITCH_PIN_2);
-    if (!waterLevelSensor->initialize()) {
+    if (!initializeSensor(waterLevelSensor)) {
         Serial.println("WARNING: Water level sensor initialization failed");
     }
     
     // Initialize battery sensor
-    batterySensor = new BatterySensor("battery_01", BATTERY_ADC_PIN);
-    if (!batterySensor->initialize()) {
+    if (!initializeSensor(batterySensor)) {
         Serial.println("WARNING: Battery sensor initialization failed");
     }
     
+#if ANALOG_PROBES_ENABLED
+    // Initialize analog probes (ADC DMA pipeline)
+    analogProbes[0] = new PhSensor("ph_01", PH_PROBE_PIN);
+    analogProbes[1] = new OrpSensor("orp_01", ORP_PROBE_PIN);
+    analogProbes[2] = new PressureLevelSensor("depth_01", PRESSURE_PROBE_PIN);
+    for (int i = 0; i < ANALOG_PROBE_COUNT; i++) {
+        if (!initializeSensor(analogProbes[i])) {
+            Serial.printf("WARNING: Analog probe %s initialization failed\n", analogProbes[i]->getId().c_str());
+        }
+    }
+#endif
+    
     Serial.println("Sensor initialization complete");
 }
 
+bool initializeSensor(PoolSensor* sensor) {
+    // An open breaker survives deep sleep; the sensor is re-probed from readSensor() when due
+    if (sensorHealth.getState(sensor->getId()) == HEALTH_OPEN) {
+        Serial.printf("Sensor %s skipped, circuit open\n", sensor->getId().c_str());
+        return false;
+    }
+    
+    unsigned long start = millis();
+    if (sensor->initialize()) {
+        return true;
+    }
+    sensorHealth.recordFailure(sensor->getId(), millis() - start, getNodeClockS(), true);
+    return false;
+}
+
+// Reads a sensor through its circuit breaker; the document is null if the sensor was skipped
+JsonDocument readSensor(PoolSensor* sensor) {
+    JsonDocument doc(&jsonArena);
+    if (!sensor || !sensorHealth.allowAttempt(sensor->getId(), getNodeClockS())) {
+        return doc;
+    }
+    
+    unsigned long start = millis();
+    // Half-open (even if it still reports available) or never came up: cheap
+    // presence check first, then a full initialize() only if it is needed
+    bool halfOpen = sensorHealth.getState(sensor->getId()) == HEALTH_HALF_OPEN;
+    if (halfOpen || !sensor->isAvailable()) {
+        if (!sensor->probe() || (!sensor->isAvailable() && !sensor->initialize())) {
+            sensorHealth.recordFailure(sensor->getId(), millis() - start, getNodeClockS(), true);
+            return doc;
+        }
+    }
+    
+    doc = sensor->readData();
+    if (doc["quality"] == "good") {
+        sensorHealth.recordSuccess(sensor->getId());
+    } else {
+        sensorHealth.recordFailure(sensor->getId(), millis() - start, getNodeClockS(), false);
+    }
+    return doc;
+}
+
 void setupMQTT() {
     Serial.println("Setting up MQTT connection...");
     
     mqttClient.initialize();
     mqttClient.setCallback(onMQTTMessage);
     
-    // Attempt connection
+    // Attempt connection until the connect budget is spent
     int attempts = 0;
-    while (!mqttClient.connect() && attempts < 5) {
+    while (!mqttClient.connect() && attempts < 5 && !cycleBudget.expired()) {
         attempts++;
         Serial.printf("MQTT connection attempt %d failed, retrying...\n", attempts);
-        delay(5000);
+        delay(min(5000UL, cycleBudget.remainingMs()));
     }
     
     if (!mqttClient.isConnected()) {
-        Serial.println("Failed to establish MQTT connection, continuing anyway...");
+        Serial.println("Failed to establish MQTT connection, readings will be buffered");
     } else {
         Serial.println("MQTT connection established");
     }
@@ -143,76 +348,251 @@ void readAndPublishSensors() {
     Serial.println("Reading sensors...");
     blinkLED(1, 100);
     
-    // Read temperature
-    if (tempSensor && tempSensor->isAvailable()) {
-        JsonDocument tempData = tempSensor->readData();
-        mqttClient.publishSensorData(TOPIC_TEMPERATURE, tempData);
+    // Start a new JSON arena cycle; no documents are alive between cycles
+    jsonArena.reset();
+    
+    // Every message of this cycle carries the same sequence number
+    uint32_t sequence = takeSequenceNumber();
+    
+    // Acquire: each sensor is read once per cycle
+    cycleBudget.beginPhase(PHASE_ACQUIRE);
+    JsonDocument tempData(&jsonArena);
+    JsonDocument levelData(&jsonArena);
+    JsonDocument batteryData(&jsonArena);
+    
+    // Sensors with an open circuit breaker are skipped and come back null
+    tempData = readSensor(tempSensor);
+    levelData = readSensor(waterLevelSensor);
+    batteryData = readSensor(batterySensor);
+#if ANALOG_PROBES_ENABLED
+    JsonDocument probeData[ANALOG_PROBE_COUNT];
+    for (int i = 0; i < ANALOG_PROBE_COUNT; i++) {
+        if (!cycleBudget.expired()) {
+            probeData[i] = readSensor(analogProbes[i]);
+        }
     }
+#endif
+    cycleBudget.endPhase();
     
-    // Read water level
-    if (waterLevelSensor && waterLevelSensor->isAvailable()) {
-        JsonDocument levelData = waterLevelSensor->readData();
-        mqttClient.publishSensorData("poolio/water_level", levelData);
-    }
+    // Publish: older buffered readings first, then this cycle
+    cycleBudget.beginPhase(PHASE_PUBLISH);
+    publishBufferedReadings();
     
-    // Read battery
-    if (batterySensor && batterySensor->isAvailable()) {
-        JsonDocument batteryData = batterySensor->readData();
-        mqttClient.publishSensorData(TOPIC_BATTERY, batteryData);
+    bool published = mqttClient.isConnected();
+    if (!tempData.isNull()) {
+        tempData["seq"] = sequence;
+        published = publishWithinBudget(TOPIC_TEMPERATURE, tempData) && published;
+    }
+    if (!levelData.isNull()) {
+        levelData["seq"] = sequence;
+        published = publishWithinBudget("poolio/water_level", levelData) && published;
     }
+    if (!batteryData.isNull()) {
+        batteryData["seq"] = sequence;
+        published = publishWithinBudget(TOPIC_BATTERY, batteryData) && published;
+    }
+#if ANALOG_PROBES_ENABLED
+    for (int i = 0; i < ANALOG_PROBE_COUNT; i++) {
+        if (!probeData[i].isNull()) {
+            probeData[i]["seq"] = sequence;
+            String topic = String(TOPIC_PROBE_PREFIX) + analogProbes[i]->getType();
+            published = publishWithinBudget(topic.c_str(), probeData[i]) && published;
+        }
+    }
+#endif
     
     // Publish gateway message (combined data)
-    publishGatewayMessage();
+    published = publishGatewayMessage(sequence, tempData, batteryData) && published;
+    cycleBudget.endPhase();
+    
+    // Every reading is kept for backfill; unpublished ones go out with the next cycle's history
+    readingBuffer.push(summarizeReadings(sequence, tempData, levelData, batteryData), !published);
+    if (!published) {
+        Serial.printf("Reading buffered (%u pending, %lu dropped)\n",
+                     (unsigned)readingBuffer.count(), readingBuffer.getDroppedCount());
+    }
     
+    flushSensorTrace();
     Serial.println("Sensor reading complete");
 }
 
-void publishGatewayMessage() {
-    JsonDocument gatewayMsg;
-    
-    // Device information
-    gatewayMsg["device_id"] = DEVICE_ID;
-    gatewayMsg["device_type"] = DEVICE_TYPE;
-    gatewayMsg["timestamp"] = millis();
-    gatewayMsg["firmware_version"] = FIRMWARE_VERSION;
-    
-    // System status  
-    gatewayMsg["uptime_ms"] = millis();
-    gatewayMsg["free_heap"] = ESP.getFreeHeap();
-    
-    // Safely get WiFi RSSI
-    if (WiFi.status() == WL_CONNECTED) {
-        gatewayMsg["wifi_rssi"] = WiFi.RSSI();
-    } else {
-        gatewayMsg["wifi_rssi"] = -99;
+bool publishWithinBudget(const char* topic, const JsonDocument& data) {
+    if (cycleBudget.expired()) {
+        Serial.printf("Publish budget exhausted, skipping %s\n", topic);
+        return false;
+    }
+    return mqttClient.publishSensorData(topic, data);
+}
+
+#if HISTORY_FORMAT == HISTORY_FORMAT_SERIES
+static_assert(SERIES_BLOCK_SIZE + 64 <= MQTT_BUFFER_SIZE, "SERIES_BLOCK_SIZE must fit in MQTT_BUFFER_SIZE");
+
+void publishBufferedReadings() {
+    static uint8_t block[SERIES_BLOCK_SIZE];
+    String topic = String(TOPIC_HISTORY) + "/" + DEVICE_ID;
+    
+    while (readingBuffer.count() > 0 && mqttClient.isConnected() && !cycleBudget.expired()) {
+        // Stream buffered readings into one block until it is full
+        SeriesEncoder encoder;
+        encoder.begin(block, sizeof(block), SERIES_QUANTIZED);
+        
+        BufferedReading reading;
+        while (readingBuffer.peek(encoder.getCount(), reading)) {
+            if (!encoder.append(toSeriesSample(reading))) {
+                break;
+            }
+        }
+        
+        size_t batch = encoder.getCount();
+        size_t length = encoder.finish(getNodeClockS());
+        if (batch == 0 || !mqttClient.publishBinary(topic, block, length)) {
+            break;
+        }
+        Serial.printf("History block: %u readings in %u bytes\n", (unsigned)batch, (unsigned)length);
+        readingBuffer.pop(batch);
+    }
+}
+#else
+void publishBufferedReadings() {
+    while (readingBuffer.count() > 0 && mqttClient.isConnected() && !cycleBudget.expired()) {
+        JsonDocument history(&jsonArena);
+        JsonArray readings = beginHistoryMessage(history, getNodeClockS());
+        
+        BufferedReading reading;
+        size_t batch = 0;
+        while (batch < HISTORY_BATCH_SIZE && readingBuffer.peek(batch, reading)) {
+            if (!addHistoryEntryWithin(history, readings, reading)) {
+                break;
+            }
+            batch++;
+        }
+        
+        if (batch == 0 || !mqttClient.publishSensorData(TOPIC_HISTORY, history, false)) {
+            break;
+        }
+        readingBuffer.pop(batch);
+    }
+}
+#endif
+
+// Kept readings in from..to go out as JSON history (whatever HISTORY_FORMAT is) with a
+// "backfill" object; numbers below "oldest_seq" are gone and the hub stops asking for them.
+// False if a message could not be published, so the command is served again next wake.
+bool publishBackfill(uint32_t commandId, uint32_t from, uint32_t to) {
+    uint32_t oldest;
+    if (!readingBuffer.getOldestSequence(oldest)) {
+        oldest = to + 1;   // Nothing kept
     }
     
-    gatewayMsg["connection_status"] = mqttClient.getConnectionStatus();
-    
-    // Sensor availability
-    JsonObject sensors = gatewayMsg["sensors"].to<JsonObject>();
-    sensors["temperature_available"] = tempSensor ? tempSensor->isAvailable() : false;
-    sensors["water_level_available"] = waterLevelSensor ? waterLevelSensor->isAvailable() : false;
-    sensors["battery_available"] = batterySensor ? batterySensor->isAvailable() : false;
+    // Kept readings have consecutive sequence numbers, so this never walks past the buffer
+    uint32_t sequence = from > oldest ? from : oldest;
+    BufferedReading reading;
+    size_t batch;
+    size_t served = 0;
+    do {
+        JsonDocument history(&jsonArena);
+        JsonArray readings = beginHistoryMessage(history, getNodeClockS());
+        JsonObject backfill = history["backfill"].to<JsonObject>();
+        backfill["id"] = commandId;
+        backfill["from"] = from;
+        backfill["to"] = to;
+        backfill["oldest_seq"] = oldest;
+        
+        batch = 0;
+        while (batch < HISTORY_BATCH_SIZE && sequence <= to && readingBuffer.find(sequence, reading)) {
+            if (!addHistoryEntryWithin(history, readings, reading)) {
+                break;
+            }
+            sequence++;
+            batch++;
+        }
+        
+        if (!mqttClient.publishSensorData(TOPIC_HISTORY, history, false)) {
+            Serial.printf("Backfill %lu-%lu: publish failed after %u readings\n",
+                         (unsigned long)from, (unsigned long)to, (unsigned)served);
+            return false;
+        }
+        served += batch;
+    } while (batch > 0 && sequence <= to && readingBuffer.find(sequence, reading));
     
-    // Quick sensor readings (for gateway summary)
-    if (tempSensor && tempSensor->isAvailable()) {
-        JsonDocument tempData = tempSensor->readData();
-        if (tempData["value"].is<float>()) {
-            gatewayMsg["temperature_f"] = tempData["value"];
+    Serial.printf("Backfill %lu-%lu: %u readings republished\n", (unsigned long)from, (unsigned long)to, (unsigned)served);
+    return true;
+}
+
+// Adds a history entry unless the message would no longer fit one publish on TOPIC_HISTORY
+bool addHistoryEntryWithin(JsonDocument& history, JsonArray readings, const BufferedReading& reading) {
+    static const size_t limit = PoolMQTTClient::maxPayloadLength(TOPIC_HISTORY);
+    addHistoryEntry(readings, reading);
+    if (measureJson(history) <= limit) {
+        return true;
+    }
+    readings.remove(readings.size() - 1);
+    return false;
+}
+
+BufferedReading summarizeReadings(uint32_t sequence, const JsonDocument& tempData, const JsonDocument& levelData,
+                                  const JsonDocument& batteryData) {
+    BufferedReading reading = {};
+    reading.sequence = sequence;
+    reading.timestampS = getNodeClockS();
+    
+    if (tempData["quality"] == "good") {
+        reading.flags |= READING_HAS_TEMPERATURE;
+        reading.temperatureCentiF = lroundf(tempData["value"].as<float>() * 100.0f);
+    }
+    if (levelData["value"].is<bool>()) {
+        reading.flags |= READING_HAS_WATER_LEVEL;
+        if (levelData["value"].as<bool>()) {
+            reading.flags |= READING_WATER_OK;
         }
     }
+    if (batteryData["quality"] == "good") {
+        reading.flags |= READING_HAS_BATTERY;
+        reading.batteryMv = lroundf(batteryData["value"].as<float>() * 1000.0f);
+        reading.batteryPercent = batteryData["percentage"].as<int>();
+    }
     
+    return reading;
+}
+
+bool publishGatewayMessage(uint32_t sequence, const JsonDocument& tempData, const JsonDocument& batteryData) {
+    if (cycleBudget.expired()) {
+        Serial.println("Publish budget exhausted, skipping gateway message");
+        return false;
+    }
     
-    if (batterySensor && batterySensor->isAvailable()) {
-        JsonDocument batteryData = batterySensor->readData();
-        if (batteryData["value"].is<float>()) {
-            gatewayMsg["battery_voltage"] = batteryData["value"];
-        }
-        if (batteryData["percentage"].is<float>()) {
-            gatewayMsg["battery_percentage"] = batteryData["percentage"];
-        }
+    GatewayStatus status;
+    status.sequence = sequence;
+    status.sequenceEpoch = getSequenceEpoch();
+    status.configRevision = nodeConfig.get().revision;
+    status.freeHeap = ESP.getFreeHeap();
+    status.wifiRssi = WiFi.status() == WL_CONNECTED ? WiFi.RSSI() : -99;
+    status.connectionStatus = mqttClient.getConnectionStatus();
+    status.tlsHandshakeMs = mqttClient.getTlsHandshakeMs();
+    status.tlsResumed = mqttClient.isTlsSessionResumed();
+    status.temperatureAvailable = tempSensor ? tempSensor->isAvailable() : false;
+    status.waterLevelAvailable = waterLevelSensor ? waterLevelSensor->isAvailable() : false;
+    status.batteryAvailable = batterySensor ? batterySensor->isAvailable() : false;
+    
+    JsonDocument gatewayMsg(&jsonArena);
+    buildGatewayMessage(gatewayMsg, status, tempData, batteryData);
+#if ANALOG_PROBES_ENABLED
+    JsonObject sensors = gatewayMsg["sensors"];
+    for (int i = 0; i < ANALOG_PROBE_COUNT; i++) {
+        sensors[analogProbes[i]->getType() + "_available"] = analogProbes[i]->isAvailable();
     }
+#endif
+    
+    // Time at each CPU frequency step since boot
+    JsonObject power = gatewayMsg["power"].to<JsonObject>();
+    powerManager.reportFrequencyTime(power["cpu_ms"].to<JsonObject>());
+#if POWER_MODE == POWER_MODE_LIGHT_SLEEP
+    // Idle time and packet wakeups since boot
+    power["mode"] = "light_sleep";
+    power["auto_light_sleep"] = powerManager.isAutoLightSleepEnabled();
+    power["idle_ms"] = powerManager.getIdleMs();
+    power["data_wakeups"] = powerManager.getDataWakeups();
+#endif
     
     // Debug gateway message before publishing
     String gatewayDebug;
@@ -220,16 +600,24 @@ void publishGatewayMessage() {
     Serial.printf("Gateway message size: %d bytes\n", gatewayDebug.length());
     Serial.printf("Gateway JSON: %s\n", gatewayDebug.c_str());
     
-    mqttClient.publishGatewayMessage(gatewayMsg);
+    return mqttClient.publishGatewayMessage(gatewayMsg);
 }
 
 void enterDeepSleep() {
+    // Drain: give outstanding acks the rest of the drain budget, then sleep regardless
+    cycleBudget.beginPhase(PHASE_DRAIN);
+    
     // Publish offline status
     mqttClient.publishStatus(DEVICE_ID, "sleeping");
-    delay(1000);
+    if (!mqttClient.flush(cycleBudget.remainingMs())) {
+        Serial.println("Drain budget exhausted, sleeping with unacknowledged publishes");
+    }
     
-    // Disconnect cleanly
-    mqttClient.disconnect();
+    // Disconnect cleanly, within whatever is left of the drain budget
+    mqttClient.disconnect(cycleBudget.remainingMs());
+    cycleBudget.endPhase();
+    unsigned long sleepDuration = nodeConfig.get().sleepDurationS;
+    advanceNodeClockForSleep(sleepDuration);
     
     // Configure wake-up timer
     esp_sleep_enable_timer_wakeup(sleepDuration * 1000000ULL); // Convert to microseconds
@@ -241,6 +629,94 @@ void enterDeepSleep() {
     esp_deep_sleep_start();
 }
 
+#if NODE_ROLE == NODE_ROLE_LEAF
+void runLeafCycle() {
+    jsonArena.reset();
+    cycleBudget.beginPhase(PHASE_ACQUIRE);
+    
+    RelayReading reading = {};
+    strncpy(reading.deviceId, DEVICE_ID, RELAY_DEVICE_ID_MAX);
+    reading.sequence = takeSequenceNumber();
+    reading.sequenceEpoch = getSequenceEpoch();
+    reading.radioMs = leafRadioMs;
+    
+    JsonDocument tempData = readSensor(tempSensor);
+    if (tempData["quality"] == "good") {
+        reading.hasTemperature = true;
+        reading.temperatureF = tempData["value"];
+    }
+    
+    JsonDocument levelData = readSensor(waterLevelSensor);
+    if (levelData["value"].is<bool>()) {
+        reading.hasWaterLevel = true;
+        reading.waterLevel = levelData["value"];
+    }
+    
+    JsonDocument batteryData = readSensor(batterySensor);
+    if (batteryData["quality"] == "good") {
+        reading.hasBattery = true;
+        reading.batteryVoltage = batteryData["value"];
+        reading.batteryPercent = batteryData["percentage"];
+    }
+    
+    cycleBudget.endPhase();
+    
+    uint8_t packet[RELAY_PACKET_MAX_SIZE];
+    size_t length = encodeRelayReading(reading, packet, sizeof(packet));
+    
+    // The radio is only powered from here until the frame is acknowledged
+    unsigned long radioStart = millis();
+    bool sent = relayLink.begin() && relayLink.send(packet, length);
+    relayLink.end();
+    WiFi.mode(WIFI_OFF);
+    leafRadioMs = millis() - radioStart;
+    
+    Serial.printf("Leaf reading #%lu %s (%u bytes, radio on %u ms)\n",
+                 (unsigned long)reading.sequence, sent ? "sent" : "NOT delivered", (unsigned)length, leafRadioMs);
+    
+    flushSensorTrace();
+    advanceNodeClockForSleep(nodeConfig.get().sleepDurationS);
+    esp_sleep_enable_timer_wakeup(nodeConfig.get().sleepDurationS * 1000000ULL);
+    Serial.flush();
+    esp_deep_sleep_start();
+}
+#endif
+
+#if NODE_ROLE == NODE_ROLE_GATEWAY
+void relayLeafReadings() {
+    RelayFrame frame;
+    while (relayLink.receive(frame)) {
+        RelayReading reading;
+        if (!decodeRelayReading(frame.data, frame.length, reading)) {
+            Serial.printf("Ignoring malformed relay frame from %02X:%02X:%02X:%02X:%02X:%02X\n",
+                         frame.mac[0], frame.mac[1], frame.mac[2], frame.mac[3], frame.mac[4], frame.mac[5]);
+            continue;
+        }
+        
+        JsonDocument doc(&jsonArena);
+        doc["device_id"] = reading.deviceId;
+        doc["relayed_by"] = DEVICE_ID;
+        doc["seq"] = reading.sequence;
+        doc["seq_epoch"] = reading.sequenceEpoch;
+        doc["timestamp"] = millis();
+        doc["leaf_radio_ms"] = reading.radioMs;
+        
+        if (reading.hasTemperature) {
+            doc["temperature_f"] = reading.temperatureF;
+        }
+        if (reading.hasWaterLevel) {
+            doc["water_level"] = reading.waterLevel;
+        }
+        if (reading.hasBattery) {
+            doc["battery_voltage"] = reading.batteryVoltage;
+            doc["battery_percentage"] = reading.batteryPercent;
+        }
+        
+        mqttClient.publishSensorData(String(TOPIC_RELAY) + "/" + reading.deviceId, doc);
+    }
+}
+#endif
+
 void onMQTTMessage(char* topic, uint8_t* payload, unsigned int length) {
     // Convert payload to string
     String message;
@@ -251,21 +727,261 @@ void onMQTTMessage(char* topic, uint8_t* payload, unsigned int length) {
     Serial.printf("MQTT message received on %s: %s\n", topic, message.c_str());
     
     // Handle configuration updates
-    if (String(topic) == TOPIC_CONFIG) {
-        JsonDocument config;
+    String deviceTopic = String(TOPIC_CONFIG) + "/" + DEVICE_ID;
+    bool mailbox = deviceTopic == topic;
+    bool command = deviceTopic + TOPIC_COMMAND_SUFFIX == topic;
+    if (mailbox || command || String(topic) == TOPIC_CONFIG) {
+        JsonDocument config(&jsonArena);
         DeserializationError error = deserializeJson(config, message);
         
-        if (!error) {
-            if (config["sleep_duration"].is<unsigned long>()) {
-                sleepDuration = config["sleep_duration"];
-                Serial.printf("Updated sleep duration to %lu seconds\n", sleepDuration);
+        if (mailbox) {
+            // An empty (cleared) mailbox still ends the wait after connecting
+            configMailboxRead = true;
+            if (!error) {
+                applyConfigMailbox(config.as<JsonObjectConst>());
+            }
+        } else if (command) {
+            // The hub clears the topic (empty payload) once it has the reply
+            if (!error) {
+                handleCommand(config.as<JsonObjectConst>());
+            }
+        } else if (!error) {
+            // NodeConfig settings only come from the mailbox, so the stored revision
+            // always describes them; the shared topic carries one-off requests
+#if TRACE_SINK == TRACE_SINK_FLASH
+            // The upload runs from loop(); every node sees the shared topic,
+            // so only the one named in device_id starts it
+            if (config["trace_upload"].as<bool>() && config["device_id"] == DEVICE_ID &&
+                !traceUploadPending) {
+                traceUploadPending = true;
+                traceUploadOffset = 0;
+                Serial.println("Sensor trace upload requested");
             }
+#endif
+#if ANALOG_PROBES_ENABLED
+            if (config["calibration"].is<JsonObjectConst>()) {
+                applyProbeCalibration(config["calibration"]);
+            }
+#endif
         } else {
             Serial.println("Failed to parse configuration JSON");
         }
     }
 }
 
+// Subscribes to the shared config topic, this node's retained command topic
+// and its retained mailbox, poolio/config/<device_id>. The broker sends retained
+// messages right after each SUBACK, so a pending command is handled before the
+// mailbox ends the wait and one round trip is enough for new settings to apply this wake.
+void subscribeConfigTopics() {
+    mqttClient.subscribe(TOPIC_CONFIG);
+    mqttClient.subscribe(String(TOPIC_CONFIG) + "/" + DEVICE_ID + TOPIC_COMMAND_SUFFIX);
+    
+    configMailboxRead = false;
+    if (!mqttClient.subscribe(String(TOPIC_CONFIG) + "/" + DEVICE_ID)) {
+        return;
+    }
+    
+    unsigned long start = millis();
+    unsigned long elapsed;
+    while (!configMailboxRead && mqttClient.isConnected() &&
+           (elapsed = millis() - start) < REMOTE_CONFIG_WAIT_MS) {
+        mqttClient.waitForIncoming(REMOTE_CONFIG_WAIT_MS - elapsed);
+        mqttClient.loop();
+    }
+    if (!configMailboxRead) {
+        Serial.println("No config mailbox received, keeping stored settings");
+    }
+}
+
+// {"rev": 7, "sleep_duration": 600, "low_battery_v": 3.4, ...}
+// A revision that was already applied costs no flash write and no publish.
+// Otherwise only the fields that differ are applied, saved and acknowledged.
+void applyConfigMailbox(JsonObjectConst mailbox) {
+    uint32_t revision = mailbox["rev"];
+    if (revision <= nodeConfig.get().revision) {
+        return;
+    }
+    
+    JsonDocument ack(&jsonArena);
+    ack["device_id"] = DEVICE_ID;
+    ack["rev"] = revision;
+    JsonObject applied = ack["applied"].to<JsonObject>();
+    JsonArray rejected = ack["rejected"].to<JsonArray>();
+    if (nodeConfig.apply(mailbox, revision, applied, rejected) > 0) {
+        applySettings();
+    }
+    
+    if (!mqttClient.publishSensorData(TOPIC_CONFIG_ACK, ack, false)) {
+        Serial.printf("Config revision %lu applied, ack not sent\n", (unsigned long)revision);
+    }
+}
+
+// {"id": 1739000000, "backfill": [{"from": 120, "to": 131}, ...]} from the hub's gap tracker.
+// The command stays retained until the hub has a reply, so one that was already
+// served (same id) is skipped; the id goes back out with every reply.
+void handleCommand(JsonObjectConst command) {
+    uint32_t id = command["id"];
+    if (id == 0 || id == lastCommandId) {
+        return;
+    }
+    
+    // Remember the command only once every range went out; the hub ignores repeated readings
+    bool served = true;
+    for (JsonVariantConst range : command["backfill"].as<JsonArrayConst>()) {
+        served = publishBackfill(id, range["from"], range["to"]) && served;
+    }
+    if (served) {
+        lastCommandId = id;
+    }
+}
+
+// Pushes the stored settings into the objects that use them
+void applySettings() {
+    const NodeSettings& settings = nodeConfig.get();
+    if (tempSensor) {
+        tempSensor->setRetries(settings.temperatureRetries);
+    }
+    if (waterLevelSensor) {
+        waterLevelSensor->setSampleCount(settings.floatSwitchSamples);
+    }
+    if (batterySensor) {
+        batterySensor->setThresholds(settings.lowBatteryV, settings.criticalBatteryV);
+    }
+    sensorHealth.setPolicy(settings.sensorFailureThreshold, settings.sensorBackoffInitialS,
+                           settings.sensorBackoffMaxS);
+    esp_log_level_set("*", (esp_log_level_t)settings.logLevel);
+}
+
+#if ANALOG_PROBES_ENABLED
+// {"calibration": {"sensor_id": "ph_01", "points": [[mv, value], ...]}}
+void applyProbeCalibration(JsonObjectConst request) {
+    const char* sensorId = request["sensor_id"];
+    JsonArrayConst points = request["points"];
+    
+    for (int i = 0; i < ANALOG_PROBE_COUNT; i++) {
+        if (!sensorId || analogProbes[i]->getId() != sensorId) {
+            continue;
+        }
+        
+        // Each point must be a [millivolts, value] pair of finite numbers; a missing
+        // or non-numeric entry would otherwise be stored as 0
+        if (points.size() < 2 || points.size() > PROBE_CAL_MAX_POINTS) {
+            Serial.printf("Calibration for %s rejected: %u points (2-%d)\n",
+                         sensorId, (unsigned)points.size(), PROBE_CAL_MAX_POINTS);
+            return;
+        }
+        
+        ProbeCalibration calibration = {};
+        calibration.version = PROBE_CAL_VERSION;
+        for (JsonVariantConst point : points) {
+            if (point.size() != 2 || !point[0].is<float>() || !point[1].is<float>() ||
+                !isfinite(point[0].as<float>()) || !isfinite(point[1].as<float>())) {
+                Serial.printf("Calibration for %s rejected: point %d is not a pair of numbers\n",
+                             sensorId, calibration.pointCount);
+                return;
+            }
+            calibration.millivolts[calibration.pointCount] = point[0];
+            calibration.values[calibration.pointCount] = point[1];
+            calibration.pointCount++;
+        }
+        
+        analogProbes[i]->setCalibration(calibration);
+        return;
+    }
+    
+    Serial.printf("Calibration ignored: unknown probe %s\n", sensorId ? sensorId : "(none)");
+}
+#endif
+
+// Ships this cycle's sensor trace chunk to the configured sink and starts the next one
+void flushSensorTrace() {
+#if TRACE_SINK != TRACE_SINK_NONE
+    size_t length = sensorTrace.finish();
+    if (length > 0) {
+#if TRACE_SINK == TRACE_SINK_MQTT
+        String topic = String(TOPIC_TRACE) + "/" + DEVICE_ID;
+        if (!mqttClient.publishBinary(topic, sensorTrace.getData(), length)) {
+            Serial.println("Sensor trace chunk dropped, MQTT unavailable");
+        }
+#else
+        appendTraceToFlash(sensorTrace.getData(), length);
+#endif
+    }
+    sensorTrace.startCycle(getNodeClockS());
+#endif
+}
+
+#if TRACE_SINK == TRACE_SINK_FLASH
+// Mounted once; begin() warns on every call when already mounted
+static bool mountTraceFs() {
+    static bool mounted = false;
+    return mounted || (mounted = LittleFS.begin(true));
+}
+
+bool appendTraceToFlash(const uint8_t* data, size_t length) {
+    if (!mountTraceFs()) {
+        Serial.println("LittleFS mount failed, sensor trace chunk dropped");
+        return false;
+    }
+    
+    // Keep one rotated file so flash use stays bounded; not while an upload
+    // is reading the file, whose offset would no longer be valid
+    File existing = LittleFS.open(TRACE_FLASH_FILE, "r");
+    size_t existingSize = existing ? existing.size() : 0;
+    existing.close();
+    if (existingSize + length > TRACE_FLASH_MAX_BYTES && !traceUploadPending) {
+        LittleFS.remove("/sensor_trace.old.bin");
+        LittleFS.rename(TRACE_FLASH_FILE, "/sensor_trace.old.bin");
+    }
+    
+    File file = LittleFS.open(TRACE_FLASH_FILE, FILE_APPEND);
+    bool written = file && file.write(data, length) == length;
+    file.close();
+    if (!written) {
+        Serial.println("Failed to append sensor trace chunk to flash");
+    }
+    return written;
+}
+
+// Publishes the next TRACE_UPLOAD_SLICES_PER_LOOP slices of a requested upload to
+// poolio/trace/<device_id>/flash and deletes the file once all of it is sent.
+// Slices do not follow chunk boundaries; concatenate them in order (mosquitto_sub -N).
+// A failed publish is retried from the same offset on a later loop().
+void serviceTraceUpload() {
+    if (!traceUploadPending || !mqttClient.isConnected()) {
+        return;
+    }
+    
+    File file = mountTraceFs() ? LittleFS.open(TRACE_FLASH_FILE, "r") : File();
+    if (!file) {
+        Serial.println("No sensor trace file to upload");
+        traceUploadPending = false;
+        return;
+    }
+    
+    String topic = String(TOPIC_TRACE) + "/" + DEVICE_ID + "/flash";
+    uint8_t slice[TRACE_BUFFER_SIZE];
+    file.seek(traceUploadOffset);
+    for (int i = 0; i < TRACE_UPLOAD_SLICES_PER_LOOP && file.available(); i++) {
+        size_t length = file.read(slice, sizeof(slice));
+        if (!mqttClient.publishBinary(topic, slice, length)) {
+            break;
+        }
+        traceUploadOffset += length;
+        esp_task_wdt_reset();
+    }
+    bool complete = traceUploadOffset >= file.size();
+    file.close();
+    
+    if (complete) {
+        Serial.printf("Uploaded %u bytes of sensor trace\n", (unsigned)traceUploadOffset);
+        LittleFS.remove(TRACE_FLASH_FILE);
+        traceUploadPending = false;
+    }
+}
+#endif
+
 void setupWatchdog() {
     esp_task_wdt_init(WATCHDOG_TIMEOUT_S, true);
     esp_task_wdt_add(NULL);
@@ -0,0 +1,749 @@
+#include "mqtt5_transport.h"
+
+// MQTT control packet types (upper nibble of the fixed header)
+#define MQTT5_CONNECT     0x10
+#define MQTT5_CONNACK     0x20
+#define MQTT5_PUBLISH     0x30
+#define MQTT5_PUBACK      0x40
+#define MQTT5_SUBSCRIBE   0x82
+#define MQTT5_SUBACK      0x90
+#define MQTT5_PINGREQ     0xC0
+#define MQTT5_PINGRESP    0xD0
+#define MQTT5_DISCONNECT  0xE0
+
+// Property identifiers used by this client
+#define MQTT5_PROP_SESSION_EXPIRY    0x11
+#define MQTT5_PROP_SERVER_KEEPALIVE  0x13
+#define MQTT5_PROP_RECEIVE_MAX       0x21
+#define MQTT5_PROP_TOPIC_ALIAS_MAX   0x22
+#define MQTT5_PROP_TOPIC_ALIAS       0x23
+#define MQTT5_PROP_MAX_QOS           0x24
+#define MQTT5_PROP_RETAIN_AVAILABLE  0x25
+#define MQTT5_PROP_MAX_PACKET_SIZE   0x27
+
+// Encoding helpers
+static size_t encodeVarint(uint8_t* out, uint32_t value) {
+    size_t n = 0;
+    do {
+        uint8_t digit = value % 128;
+        value /= 128;
+        if (value > 0) {
+            digit |= 0x80;
+        }
+        out[n++] = digit;
+    } while (value > 0);
+    return n;
+}
+
+static bool decodeVarint(const uint8_t* data, size_t length, size_t& pos, uint32_t& value) {
+    value = 0;
+    uint32_t multiplier = 1;
+    for (int i = 0; i < 4; i++) {
+        if (pos >= length) {
+            return false;
+        }
+        uint8_t digit = data[pos++];
+        value += (digit & 0x7F) * multiplier;
+        if ((digit & 0x80) == 0) {
+            return true;
+        }
+        multiplier *= 128;
+    }
+    return false;
+}
+
+static size_t writeUint16(uint8_t* out, uint16_t value) {
+    out[0] = value >> 8;
+    out[1] = value & 0xFF;
+    return 2;
+}
+
+static size_t writeUint32(uint8_t* out, uint32_t value) {
+    out[0] = value >> 24;
+    out[1] = (value >> 16) & 0xFF;
+    out[2] = (value >> 8) & 0xFF;
+    out[3] = value & 0xFF;
+    return 4;
+}
+
+static size_t writeString(uint8_t* out, const char* str, size_t length) {
+    writeUint16(out, length);
+    memcpy(out + 2, str, length);
+    return length + 2;
+}
+
+static uint16_t readUint16(const uint8_t* data) {
+    return (data[0] << 8) | data[1];
+}
+
+// Read one property, returning its numeric value (string/binary properties are skipped)
+static bool readProperty(const uint8_t* data, size_t end, size_t& pos, uint8_t& id, uint32_t& value) {
+    if (pos >= end) {
+        return false;
+    }
+    id = data[pos++];
+    value = 0;
+
+    switch (id) {
+        case 0x01: case 0x17: case 0x19: case 0x24: case 0x25:
+        case 0x28: case 0x29: case 0x2A:
+            if (pos + 1 > end) return false;
+            value = data[pos];
+            pos += 1;
+            return true;
+        case 0x13: case 0x21: case 0x22: case 0x23:
+            if (pos + 2 > end) return false;
+            value = readUint16(data + pos);
+            pos += 2;
+            return true;
+        case 0x02: case 0x11: case 0x18: case 0x27:
+            if (pos + 4 > end) return false;
+            value = ((uint32_t)data[pos] << 24) | ((uint32_t)data[pos + 1] << 16) |
+                    ((uint32_t)data[pos + 2] << 8) | data[pos + 3];
+            pos += 4;
+            return true;
+        case 0x0B:
+            return decodeVarint(data, end, pos, value);
+        case 0x03: case 0x08: case 0x09: case 0x12: case 0x15:
+        case 0x16: case 0x1A: case 0x1C: case 0x1F:
+            if (pos + 2 > end) return false;
+            pos += 2 + readUint16(data + pos);
+            return pos <= end;
+        case 0x26:
+            for (int i = 0; i < 2; i++) {
+                if (pos + 2 > end) return false;
+                pos += 2 + readUint16(data + pos);
+            }
+            return pos <= end;
+        default:
+            return false;
+    }
+}
+
+// Mqtt5Transport Implementation
+Mqtt5Transport::Mqtt5Transport(Client& client)
+    : client(client), host(nullptr), port(0), keepAliveS(MQTT_KEEPALIVE),
+      connectTimeoutMs(MQTT_TIMEOUT_MS), callback(nullptr), lastState(MQTT_DISCONNECTED) {
+    sessionPresent = false;
+    serverReceiveMax = 65535;
+    serverTopicAliasMax = 0;
+    serverMaxPacketSize = 0;
+    serverMaxQos = 1;
+    serverRetainAvailable = true;
+
+    for (size_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+        pending[i].packetId = 0;
+    }
+    pendingCount = 0;
+    nextPacketId = 1;
+    ackedCount = 0;
+    rejectedCount = 0;
+    aliasCount = 0;
+
+    lastOutbound = 0;
+    pingSentAt = 0;
+    pingOutstanding = false;
+    dispatching = false;
+    connackReceived = false;
+    resetReceiver();
+}
+
+void Mqtt5Transport::setServer(const char* host, uint16_t port) {
+    this->host = host;
+    this->port = port;
+}
+
+void Mqtt5Transport::setKeepAlive(uint16_t seconds) {
+    keepAliveS = seconds;
+}
+
+bool Mqtt5Transport::connect(const char* clientId, const char* username, const char* password) {
+    if (client.connected()) {
+        client.stop();
+    }
+    resetReceiver();
+
+    if (!client.connect(host, port)) {
+        lastState = MQTT_CONNECT_FAILED;
+        return false;
+    }
+
+    size_t userLength = strlen(username);
+    size_t passLength = strlen(password);
+    size_t needed = 10 + 20 + 2 + strlen(clientId) + 2 + userLength + 2 + passLength;
+    if (needed > bodyCapacity()) {
+        closeConnection(MQTT_CONNECT_FAILED);
+        return false;
+    }
+
+    // Variable header
+    uint8_t* out = body();
+    size_t pos = writeString(out, "MQTT", 4);
+    out[pos++] = 5; // Protocol version
+
+    uint8_t flags = 0;
+    if (!MQTT_PERSISTENT_SESSION) {
+        flags |= 0x02; // Clean start
+    }
+    if (userLength > 0) {
+        flags |= 0x80;
+        if (passLength > 0) {
+            flags |= 0x40;
+        }
+    }
+    out[pos++] = flags;
+    pos += writeUint16(out + pos, keepAliveS);
+
+    // Properties
+    uint8_t props[20];
+    size_t propLength = 0;
+    if (MQTT_PERSISTENT_SESSION) {
+        props[propLength++] = MQTT5_PROP_SESSION_EXPIRY;
+        propLength += writeUint32(props + propLength, MQTT_SESSION_EXPIRY_S);
+    }
+    props[propLength++] = MQTT5_PROP_RECEIVE_MAX;
+    propLength += writeUint16(props + propLength, MQTT_INFLIGHT_WINDOW);
+    props[propLength++] = MQTT5_PROP_MAX_PACKET_SIZE;
+    propLength += writeUint32(props + propLength, MQTT_BUFFER_SIZE);
+    pos += encodeVarint(out + pos, propLength);
+    memcpy(out + pos, props, propLength);
+    pos += propLength;
+
+    // Payload
+    pos += writeString(out + pos, clientId, strlen(clientId));
+    if (flags & 0x80) {
+        pos += writeString(out + pos, username, userLength);
+    }
+    if (flags & 0x40) {
+        pos += writeString(out + pos, password, passLength);
+    }
+
+    if (!sendPacket(MQTT5_CONNECT, pos)) {
+        closeConnection(MQTT_CONNECT_FAILED);
+        return false;
+    }
+
+    // Wait for CONNACK; everything after this point is asynchronous
+    connackReceived = false;
+    unsigned long start = millis();
+    while (!connackReceived) {
+        if (readIncoming()) {
+            continue;
+        }
+        if (!client.connected()) {
+            lastState = MQTT_CONNECTION_LOST;
+            return false;
+        }
+        if (millis() - start > connectTimeoutMs) {
+            closeConnection(MQTT_CONNECTION_TIMEOUT);
+            return false;
+        }
+        delay(10);
+    }
+
+    if (lastState != MQTT_CONNECTED) {
+        client.stop();
+        return false;
+    }
+
+    // Aliases are scoped to a single network connection
+    aliasCount = 0;
+    pingOutstanding = false;
+
+    Serial.printf("MQTT5 session %s (receive max %u, topic aliases %u)\n",
+                 sessionPresent ? "resumed" : "created",
+                 serverReceiveMax, serverTopicAliasMax);
+
+    resendPending();
+    return true;
+}
+
+bool Mqtt5Transport::connected() {
+    if (lastState == MQTT_CONNECTED && !client.connected()) {
+        lastState = MQTT_CONNECTION_LOST;
+    }
+    return lastState == MQTT_CONNECTED;
+}
+
+void Mqtt5Transport::disconnect() {
+    if (connected()) {
+        sendPacket(MQTT5_DISCONNECT, 0);
+    }
+    closeConnection(MQTT_DISCONNECTED);
+}
+
+bool Mqtt5Transport::loop() {
+    if (!connected()) {
+        return false;
+    }
+
+    readIncoming();
+
+    unsigned long now = millis();
+    if (pingOutstanding && now - pingSentAt > MQTT_TIMEOUT_MS) {
+        Serial.println("MQTT5 keepalive timed out");
+        closeConnection(MQTT_CONNECTION_TIMEOUT);
+        return false;
+    }
+    if (keepAliveS > 0 && !pingOutstanding && now - lastOutbound >= keepAliveS * 1000UL) {
+        if (sendPacket(MQTT5_PINGREQ, 0)) {
+            pingOutstanding = true;
+            pingSentAt = now;
+        }
+    }
+
+    return connected();
+}
+
+bool Mqtt5Transport::hasBufferedData() {
+    // A partly received packet, or bytes left in the client (decrypted TLS
+    // records, or unread because a callback was dispatching)
+    return rxPhase != RX_HEADER || client.available() > 0;
+}
+
+bool Mqtt5Transport::publish(const char* topic, const uint8_t* payload, size_t length, bool retained) {
+    if (!connected()) {
+        return false;
+    }
+
+    uint8_t qos = MQTT_PUBLISH_QOS < serverMaxQos ? MQTT_PUBLISH_QOS : serverMaxQos;
+    if (!serverRetainAvailable) {
+        retained = false;
+    }
+
+    if (qos == 0) {
+        return sendPublish(topic, payload, length, retained, 0, 0, false);
+    }
+
+    // Wait for a free slot in the in-flight window
+    unsigned long start = millis();
+    while (pendingCount >= windowSize()) {
+        if (dispatching || !loop() || millis() - start > MQTT_ACK_TIMEOUT_MS) {
+            Serial.printf("MQTT5 in-flight window full (%u pending), dropping publish to %s\n",
+                         (unsigned)pendingCount, topic);
+            return false;
+        }
+        delay(1);
+    }
+
+    PendingPublish* slot = nullptr;
+    for (size_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+        if (pending[i].packetId == 0) {
+            slot = &pending[i];
+            break;
+        }
+    }
+
+    slot->packetId = allocatePacketId();
+    slot->retained = retained;
+    slot->topic = topic;
+    slot->payload.assign(payload, payload + length);
+    pendingCount++;
+
+    if (!sendPublish(topic, payload, length, retained, qos, slot->packetId, false)) {
+        slot->packetId = 0;
+        slot->payload.clear();
+        pendingCount--;
+        return false;
+    }
+
+    return true;
+}
+
+bool Mqtt5Transport::subscribe(const char* topic) {
+    if (!connected()) {
+        return false;
+    }
+
+    size_t topicLength = strlen(topic);
+    if (topicLength + 6 > bodyCapacity()) {
+        return false;
+    }
+
+    uint8_t* out = body();
+    size_t pos = writeUint16(out, allocatePacketId());
+    out[pos++] = 0; // No properties
+    pos += writeString(out + pos, topic, topicLength);
+    out[pos++] = 0x01; // Maximum QoS 1
+
+    // SUBACK is consumed asynchronously by loop()
+    return sendPacket(MQTT5_SUBSCRIBE, pos);
+}
+
+void Mqtt5Transport::setCallback(MqttCallback callback) {
+    this->callback = callback;
+}
+
+bool Mqtt5Transport::flush(unsigned long timeoutMs) {
+    unsigned long start = millis();
+    while (pendingCount > 0 && millis() - start < timeoutMs) {
+        if (!loop()) {
+            break;
+        }
+        delay(5);
+    }
+
+    if (pendingCount > 0) {
+        Serial.printf("MQTT5 flush: %u publishes still unacknowledged\n", (unsigned)pendingCount);
+        return false;
+    }
+    return true;
+}
+
+int Mqtt5Transport::state() {
+    connected();
+    return lastState;
+}
+
+String Mqtt5Transport::describeState() {
+    switch (state()) {
+        case MQTT_CONNECTED:
+            return "Connected";
+        case MQTT_CONNECTION_TIMEOUT:
+            return "MQTT connection timeout";
+        case MQTT_CONNECTION_LOST:
+            return "MQTT connection lost";
+        case MQTT_CONNECT_FAILED:
+            return "MQTT connect failed";
+        case MQTT_DISCONNECTED:
+            return "MQTT disconnected";
+        case 0x84:
+            return "MQTT bad protocol";
+        case 0x85:
+            return "MQTT bad client ID";
+        case 0x88:
+            return "MQTT server unavailable";
+        case 0x86:
+            return "MQTT bad credentials";
+        case 0x87:
+            return "MQTT unauthorized";
+        default:
+            return "MQTT unknown error";
+    }
+}
+
+bool Mqtt5Transport::sendPacket(uint8_t header, size_t bodyLength) {
+    // The fixed header is written backwards into the space reserved before the body
+    uint8_t lengthBytes[4];
+    size_t lengthSize = encodeVarint(lengthBytes, bodyLength);
+    uint8_t* start = body() - 1 - lengthSize;
+    start[0] = header;
+    memcpy(start + 1, lengthBytes, lengthSize);
+
+    size_t total = 1 + lengthSize + bodyLength;
+    size_t written = client.write(start, total);
+    if (written != total) {
+        return false;
+    }
+
+    lastOutbound = millis();
+    return true;
+}
+
+bool Mqtt5Transport::sendPublish(const char* topic, const uint8_t* payload, size_t length,
+                                 bool retained, uint8_t qos, uint16_t packetId, bool dup) {
+    size_t topicLength = strlen(topic);
+
+    // Reuse or assign a topic alias
+    uint16_t alias = 0;
+    bool sendTopic = true;
+    uint16_t aliasLimit = serverTopicAliasMax < MQTT_TOPIC_ALIAS_MAX ? serverTopicAliasMax : MQTT_TOPIC_ALIAS_MAX;
+    for (uint16_t i = 0; i < aliasCount; i++) {
+        if (aliasTopics[i] == topic) {
+            alias = i + 1;
+            sendTopic = false;
+            break;
+        }
+    }
+    // A new alias is only remembered once the broker has been sent the packet defining it
+    bool newAlias = alias == 0 && aliasCount < aliasLimit;
+    if (newAlias) {
+        alias = aliasCount + 1;
+    }
+
+    size_t needed = 2 + (sendTopic ? topicLength : 0) + (qos > 0 ? 2 : 0) + 4 + length;
+    if (needed > bodyCapacity() || (serverMaxPacketSize > 0 && needed + 5 > serverMaxPacketSize)) {
+        Serial.printf("MQTT5 publish to %s too large (%u bytes)\n", topic, (unsigned)needed);
+        return false;
+    }
+
+    uint8_t* out = body();
+    size_t pos = writeString(out, topic, sendTopic ? topicLength : 0);
+    if (qos > 0) {
+        pos += writeUint16(out + pos, packetId);
+    }
+    if (alias > 0) {
+        out[pos++] = 3;
+        out[pos++] = MQTT5_PROP_TOPIC_ALIAS;
+        pos += writeUint16(out + pos, alias);
+    } else {
+        out[pos++] = 0;
+    }
+    memcpy(out + pos, payload, length);
+    pos += length;
+
+    uint8_t header = MQTT5_PUBLISH | (qos << 1);
+    if (dup) {
+        header |= 0x08;
+    }
+    if (retained) {
+        header |= 0x01;
+    }
+    if (!sendPacket(header, pos)) {
+        return false;
+    }
+    if (newAlias) {
+        aliasTopics[aliasCount++] = topic;
+    }
+    return true;
+}
+
+bool Mqtt5Transport::readIncoming() {
+    if (dispatching) {
+        return false;
+    }
+
+    bool processed = false;
+    while (client.available() > 0) {
+        int value = client.read();
+        if (value < 0) {
+            break;
+        }
+        uint8_t b = value;
+        processed = true;
+
+        switch (rxPhase) {
+            case RX_HEADER:
+                rxHeader = b;
+                rxLength = 0;
+                rxMultiplier = 1;
+                rxPhase = RX_LENGTH;
+                break;
+            case RX_LENGTH:
+                rxLength += (b & 0x7F) * rxMultiplier;
+                rxMultiplier *= 128;
+                if ((b & 0x80) == 0) {
+                    rxPos = 0;
+                    rxOverflow = rxLength > sizeof(rxBuffer);
+                    rxPhase = RX_BODY;
+                    if (rxLength == 0) {
+                        handlePacket();
+                    }
+                }
+                break;
+            case RX_BODY:
+                if (rxPos < sizeof(rxBuffer)) {
+                    rxBuffer[rxPos] = b;
+                }
+                rxPos++;
+                if (rxPos >= rxLength) {
+                    handlePacket();
+                }
+                break;
+        }
+    }
+    return processed;
+}
+
+void Mqtt5Transport::handlePacket() {
+    rxPhase = RX_HEADER;
+    if (rxOverflow) {
+        Serial.printf("MQTT5 dropped oversized packet (%lu bytes)\n", (unsigned long)rxLength);
+        return;
+    }
+
+    dispatching = true;
+    switch (rxHeader & 0xF0) {
+        case MQTT5_CONNACK:
+            handleConnack(rxBuffer, rxLength);
+            break;
+        case MQTT5_PUBACK:
+            handlePuback(rxBuffer, rxLength);
+            break;
+        case MQTT5_PUBLISH:
+            handlePublish(rxHeader, rxBuffer, rxLength);
+            break;
+        case MQTT5_SUBACK:
+            if (rxLength >= 4 && rxBuffer[rxLength - 1] >= 0x80) {
+                Serial.printf("MQTT5 subscription rejected, reason 0x%02X\n", rxBuffer[rxLength - 1]);
+            }
+            break;
+        case MQTT5_PINGRESP:
+            pingOutstanding = false;
+            break;
+        case MQTT5_DISCONNECT:
+            Serial.printf("MQTT5 server disconnect, reason 0x%02X\n", rxLength > 0 ? rxBuffer[0] : 0);
+            closeConnection(MQTT_CONNECTION_LOST);
+            break;
+        default:
+            break;
+    }
+    dispatching = false;
+}
+
+void Mqtt5Transport::handleConnack(const uint8_t* data, size_t length) {
+    connackReceived = true;
+    if (length < 2) {
+        lastState = MQTT_CONNECT_FAILED;
+        return;
+    }
+
+    sessionPresent = data[0] & 0x01;
+    uint8_t reason = data[1];
+    lastState = reason == 0 ? MQTT_CONNECTED : reason;
+
+    // Reset to protocol defaults before applying properties
+    serverReceiveMax = 65535;
+    serverTopicAliasMax = 0;
+    serverMaxPacketSize = 0;
+    serverMaxQos = 1;
+    serverRetainAvailable = true;
+
+    size_t pos = 2;
+    uint32_t propLength;
+    if (!decodeVarint(data, length, pos, propLength)) {
+        return;
+    }
+    size_t end = pos + propLength < length ? pos + propLength : length;
+
+    uint8_t id;
+    uint32_t value;
+    while (pos < end && readProperty(data, end, pos, id, value)) {
+        switch (id) {
+            case MQTT5_PROP_RECEIVE_MAX:
+                serverReceiveMax = value;
+                break;
+            case MQTT5_PROP_TOPIC_ALIAS_MAX:
+                serverTopicAliasMax = value;
+                break;
+            case MQTT5_PROP_MAX_PACKET_SIZE:
+                serverMaxPacketSize = value;
+                break;
+            case MQTT5_PROP_MAX_QOS:
+                serverMaxQos = value;
+                break;
+            case MQTT5_PROP_RETAIN_AVAILABLE:
+                serverRetainAvailable = value != 0;
+                break;
+            case MQTT5_PROP_SERVER_KEEPALIVE:
+                keepAliveS = value;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void Mqtt5Transport::handlePuback(const uint8_t* data, size_t length) {
+    if (length < 2) {
+        return;
+    }
+
+    uint16_t packetId = readUint16(data);
+    uint8_t reason = length >= 3 ? data[2] : 0;
+
+    for (size_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+        if (pending[i].packetId == packetId) {
+            if (reason >= 0x80) {
+                rejectedCount++;
+                Serial.printf("MQTT5 publish to %s rejected, reason 0x%02X\n",
+                             pending[i].topic.c_str(), reason);
+            } else {
+                ackedCount++;
+            }
+            pending[i].packetId = 0;
+            pending[i].payload.clear();
+            pendingCount--;
+            return;
+        }
+    }
+}
+
+void Mqtt5Transport::handlePublish(uint8_t header, uint8_t* data, size_t length) {
+    if (length < 2) {
+        return;
+    }
+
+    uint8_t qos = (header >> 1) & 0x03;
+    size_t topicLength = readUint16(data);
+    size_t pos = 2 + topicLength;
+    uint16_t packetId = 0;
+    if (qos > 0) {
+        if (pos + 2 > length) {
+            return;
+        }
+        packetId = readUint16(data + pos);
+        pos += 2;
+    }
+
+    uint32_t propLength;
+    if (!decodeVarint(data, length, pos, propLength) || pos + propLength > length) {
+        return;
+    }
+    pos += propLength;
+
+    if (qos == 1) {
+        uint8_t* out = body();
+        size_t ackLength = writeUint16(out, packetId);
+        sendPacket(MQTT5_PUBACK, ackLength);
+    }
+
+    // We never advertise a topic alias maximum, so inbound topics are always present
+    if (topicLength == 0 || !callback) {
+        return;
+    }
+
+    // Shift the topic over its length prefix so it can be NUL-terminated in place
+    memmove(data, data + 2, topicLength);
+    data[topicLength] = '\0';
+    callback((char*)data, data + pos, length - pos);
+}
+
+void Mqtt5Transport::resendPending() {
+    for (size_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+        if (pending[i].packetId != 0) {
+            sendPublish(pending[i].topic.c_str(), pending[i].payload.data(), pending[i].payload.size(),
+                        pending[i].retained, 1, pending[i].packetId, sessionPresent);
+        }
+    }
+}
+
+uint16_t Mqtt5Transport::allocatePacketId() {
+    while (true) {
+        uint16_t id = nextPacketId++;
+        if (nextPacketId == 0) {
+            nextPacketId = 1;
+        }
+
+        bool inUse = false;
+        for (size_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++) {
+            if (pending[i].packetId == id) {
+                inUse = true;
+                break;
+            }
+        }
+        if (!inUse) {
+            return id;
+        }
+    }
+}
+
+size_t Mqtt5Transport::windowSize() const {
+    return serverReceiveMax < MQTT_INFLIGHT_WINDOW ? serverReceiveMax : MQTT_INFLIGHT_WINDOW;
+}
+
+void Mqtt5Transport::closeConnection(int newState) {
+    client.stop();
+    lastState = newState;
+    pingOutstanding = false;
+    resetReceiver();
+}
+
+void Mqtt5Transport::resetReceiver() {
+    rxPhase = RX_HEADER;
+    rxHeader = 0;
+    rxLength = 0;
+    rxMultiplier = 1;
+    rxPos = 0;
+    rxOverflow = false;
+}
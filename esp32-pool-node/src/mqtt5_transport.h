@@ -0,0 +1,113 @@
+#ifndef MQTT5_TRANSPORT_H
+#define MQTT5_TRANSPORT_H
+
+#include <vector>
+#include "mqtt_transport.h"
+#include "config.h"
+
+// Non-blocking MQTT 5 transport.
+// Publishes at MQTT_PUBLISH_QOS with up to MQTT_INFLIGHT_WINDOW unacknowledged
+// messages on the wire; PUBACKs are consumed from loop(). Repeated topics are
+// sent as MQTT 5 topic aliases, and with MQTT_PERSISTENT_SESSION the broker
+// keeps subscriptions (and queued config messages) across deep sleep.
+class Mqtt5Transport : public MqttTransport {
+public:
+    explicit Mqtt5Transport(Client& client);
+
+    void setServer(const char* host, uint16_t port) override;
+    void setKeepAlive(uint16_t seconds) override;
+    bool connect(const char* clientId, const char* username, const char* password) override;
+    bool connected() override;
+    void disconnect() override;
+    bool loop() override;
+    void setConnectTimeout(unsigned long timeoutMs) override { connectTimeoutMs = timeoutMs; }
+
+    bool publish(const char* topic, const uint8_t* payload, size_t length, bool retained) override;
+    bool subscribe(const char* topic) override;
+    void setCallback(MqttCallback callback) override;
+
+    bool flush(unsigned long timeoutMs) override;
+    size_t inFlight() const override { return pendingCount; }
+    bool hasBufferedData() override;
+
+    int state() override;
+    String describeState() override;
+    String getName() const override { return "mqtt5"; }
+
+    bool isSessionPresent() const { return sessionPresent; }
+    unsigned long getAckedCount() const { return ackedCount; }
+    unsigned long getRejectedCount() const { return rejectedCount; }
+
+private:
+    struct PendingPublish {
+        uint16_t packetId;  // 0 marks a free slot
+        bool retained;
+        String topic;
+        std::vector<uint8_t> payload;
+    };
+
+    Client& client;
+    const char* host;
+    uint16_t port;
+    uint16_t keepAliveS;
+    unsigned long connectTimeoutMs;
+    MqttCallback callback;
+    int lastState;
+
+    // Limits negotiated in CONNACK
+    bool sessionPresent;
+    uint16_t serverReceiveMax;
+    uint16_t serverTopicAliasMax;
+    uint32_t serverMaxPacketSize;
+    uint8_t serverMaxQos;
+    bool serverRetainAvailable;
+
+    // Outbound QoS1 window
+    PendingPublish pending[MQTT_INFLIGHT_WINDOW];
+    size_t pendingCount;
+    uint16_t nextPacketId;
+    unsigned long ackedCount;
+    unsigned long rejectedCount;
+
+    // Topic aliases assigned on this connection (alias N = aliasTopics[N - 1])
+    String aliasTopics[MQTT_TOPIC_ALIAS_MAX];
+    uint16_t aliasCount;
+
+    // Keepalive
+    unsigned long lastOutbound;
+    unsigned long pingSentAt;
+    bool pingOutstanding;
+
+    // Receive state machine
+    enum RxPhase { RX_HEADER, RX_LENGTH, RX_BODY };
+    RxPhase rxPhase;
+    uint8_t rxHeader;
+    uint32_t rxLength;
+    uint32_t rxMultiplier;
+    uint32_t rxPos;
+    bool rxOverflow;
+    bool dispatching;
+    bool connackReceived;
+
+    uint8_t txBuffer[MQTT_BUFFER_SIZE];
+    uint8_t rxBuffer[MQTT_BUFFER_SIZE];
+
+    uint8_t* body() { return txBuffer + 5; }
+    size_t bodyCapacity() const { return MQTT_BUFFER_SIZE - 5; }
+
+    bool sendPacket(uint8_t header, size_t bodyLength);
+    bool sendPublish(const char* topic, const uint8_t* payload, size_t length,
+                     bool retained, uint8_t qos, uint16_t packetId, bool dup);
+    bool readIncoming();
+    void handlePacket();
+    void handleConnack(const uint8_t* data, size_t length);
+    void handlePuback(const uint8_t* data, size_t length);
+    void handlePublish(uint8_t header, uint8_t* data, size_t length);
+    void resendPending();
+    uint16_t allocatePacketId();
+    size_t windowSize() const;
+    void closeConnection(int newState);
+    void resetReceiver();
+};
+
+#endif
@@ -1,8 +1,27 @@
 #include "mqtt_client.h"
 #include "config.h"
 #include "secrets.h"
+#include "mqtt5_transport.h"
+#include "json_arena.h"
+#include "cycle_budget.h"
+#include "power_manager.h"
+#include <lwip/sockets.h>
 
-PoolMQTTClient::PoolMQTTClient() : mqttClient(wifiClient) {
+PoolMQTTClient::PoolMQTTClient() {
+    Client* netClient = &wifiClient;
+    tlsClient = nullptr;
+#if MQTT_USE_TLS
+    tlsClient = new TlsClient();
+    tlsClient->setCACert(MQTT_CA_CERT);
+    tlsClient->setServerName(MQTT_TLS_SERVER_NAME);
+    netClient = tlsClient;
+#endif
+
+#if MQTT_TRANSPORT == MQTT_TRANSPORT_MQTT5
+    transport = new Mqtt5Transport(*netClient);
+#else
+    transport = new PubSubTransport(*netClient);
+#endif
     clientId = createClientId();
     lastConnectionAttempt = 0;
     connectionRetries = 0;
@@ -10,43 +29,47 @@ PoolMQTTClient::PoolMQTTClient() : mqttClient(wifiClient) {
 
 bool PoolMQTTClient::initialize() {
     // Set MQTT server and port
-    mqttClient.setServer(MQTT_BROKER_HOST, MQTT_BROKER_PORT);
-    mqttClient.setKeepAlive(MQTT_KEEPALIVE);
-    mqttClient.setSocketTimeout(10);
-    
-    // Increase buffer size for larger messages (default is 256 bytes)
-    mqttClient.setBufferSize(512);
+    transport->setServer(MQTT_BROKER_HOST, MQTT_BROKER_PORT);
+    transport->setKeepAlive(MQTT_KEEPALIVE);
     
-    Serial.printf("MQTT client initialized: %s:%d (buffer: 512 bytes)\n", MQTT_BROKER_HOST, MQTT_BROKER_PORT);
+    Serial.printf("MQTT client initialized: %s:%d (transport: %s, TLS: %s, buffer: %d bytes)\n",
+                 MQTT_BROKER_HOST, MQTT_BROKER_PORT, transport->getName().c_str(),
+                 tlsClient ? "on" : "off", MQTT_BUFFER_SIZE);
     return true;
 }
 
 bool PoolMQTTClient::connect() {
+    // Out of budget: the caller buffers the reading and sleeps instead
+    if (cycleBudget.expired()) {
+        Serial.println("Connect budget spent, not connecting");
+        return false;
+    }
+    
     if (!connectToWiFi()) {
         Serial.println("WiFi connection failed");
         return false;
     }
     
-    // Test basic connectivity to server first
-    Serial.printf("Testing basic connectivity to %s...\n", MQTT_BROKER_HOST);
-    WiFiClient pingClient;
-    if (pingClient.connect(MQTT_BROKER_HOST, 80)) {
-        Serial.println("Can reach server on port 80: SUCCESS");
-        pingClient.stop();
-    } else {
-        Serial.println("Cannot reach server on port 80: FAILED");
+    if (cycleBudget.expired()) {
+        Serial.println("Connect budget spent after WiFi, not connecting to MQTT");
+        return false;
     }
     
-    // Test network connectivity to MQTT port
-    Serial.printf("Testing network connectivity to %s:%d...\n", MQTT_BROKER_HOST, MQTT_BROKER_PORT);
-    WiFiClient testClient;
-    if (testClient.connect(MQTT_BROKER_HOST, MQTT_BROKER_PORT)) {
-        Serial.println("Network connection to MQTT broker: SUCCESS");
-        testClient.stop();
-    } else {
-        Serial.println("Network connection to MQTT broker: FAILED");
-        return false;
+    // The TLS handshake and CONNACK wait each end with the phase budget
+    // (remainingMs() is 0 outside a wake-cycle phase: keep the defaults)
+    unsigned long remainingMs = cycleBudget.remainingMs();
+    unsigned long tlsTimeoutMs = MQTT_TLS_HANDSHAKE_TIMEOUT_MS;
+    unsigned long connackTimeoutMs = MQTT_TIMEOUT_MS;
+    if (remainingMs > 0 && remainingMs < tlsTimeoutMs) {
+        tlsTimeoutMs = remainingMs;
     }
+    if (remainingMs > 0 && remainingMs < connackTimeoutMs) {
+        connackTimeoutMs = remainingMs;
+    }
+    if (tlsClient) {
+        tlsClient->setConnectTimeout(tlsTimeoutMs);
+    }
+    transport->setConnectTimeout(connackTimeoutMs);
     
     // Attempt MQTT connection
     Serial.printf("Attempting MQTT connection to %s...\n", MQTT_BROKER_HOST);
@@ -54,14 +77,12 @@ bool PoolMQTTClient::connect() {
     Serial.printf("Using client ID: %s\n", clientId.c_str());
     Serial.printf("Using credentials: %s\n", strlen(MQTT_USERNAME) > 0 ? "YES" : "NO (anonymous)");
     
-    bool connected;
     if (strlen(MQTT_USERNAME) > 0) {
         Serial.printf("Connecting with username: %s\n", MQTT_USERNAME);
-        connected = mqttClient.connect(clientId.c_str(), MQTT_USERNAME, MQTT_PASSWORD);
     } else {
         Serial.println("Connecting anonymously...");
-        connected = mqttClient.connect(clientId.c_str());
     }
+    bool connected = transport->connect(clientId.c_str(), MQTT_USERNAME, MQTT_PASSWORD);
     
     if (connected) {
         Serial.println("MQTT connected successfully");
@@ -74,61 +95,91 @@ bool PoolMQTTClient::connect() {
     } else {
         connectionRetries++;
         Serial.printf("MQTT connection failed, rc=%d, retries=%d\n", 
-                     mqttClient.state(), connectionRetries);
+                     transport->state(), connectionRetries);
         return false;
     }
 }
 
 bool PoolMQTTClient::isConnected() {
-    return mqttClient.connected() && WiFi.status() == WL_CONNECTED;
+    return transport->connected() && WiFi.status() == WL_CONNECTED;
 }
 
-void PoolMQTTClient::disconnect() {
-    if (mqttClient.connected()) {
+void PoolMQTTClient::disconnect(unsigned long timeoutMs) {
+    if (transport->connected()) {
         publishStatus(DEVICE_ID, "offline");
-        mqttClient.disconnect();
+        transport->flush(timeoutMs);
+        transport->disconnect();
     }
     WiFi.disconnect();
 }
 
 void PoolMQTTClient::loop() {
     if (isConnected()) {
-        mqttClient.loop();
-    } else {
-        // Attempt reconnection if enough time has passed
-        unsigned long now = millis();
-        if (now - lastConnectionAttempt > 30000) { // Try every 30 seconds
-            lastConnectionAttempt = now;
-            reconnect();
-        }
+        transport->loop();
+    } else if (shouldReconnect()) {
+        reconnect();
     }
 }
 
-bool PoolMQTTClient::publishSensorData(const String& topic, const JsonDocument& data) {
+bool PoolMQTTClient::flush(unsigned long timeoutMs) {
+    if (!isConnected()) {
+        return transport->inFlight() == 0;
+    }
+    return transport->flush(timeoutMs);
+}
+
+bool PoolMQTTClient::waitForIncoming(unsigned long timeoutMs) {
+    int fd = tlsClient ? tlsClient->fd() : wifiClient.fd();
+    if (!isConnected() || fd < 0) {
+        delay(timeoutMs);
+        return false;
+    }
+    
+    // The transport or TLS may already hold data that select() cannot see
+    if (transport->hasBufferedData() ||
+        (tlsClient ? tlsClient->available() : wifiClient.available()) > 0) {
+        return true;
+    }
+    
+    // Blocking in lwIP lets the idle task light-sleep until a packet or the timeout
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(fd, &readable);
+    struct timeval timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_usec = (timeoutMs % 1000) * 1000;
+    return select(fd + 1, &readable, nullptr, nullptr, &timeout) > 0;
+}
+
+bool PoolMQTTClient::publishSensorData(const String& topic, const JsonDocument& data, bool retained) {
     if (!isConnected()) {
         Serial.println("MQTT not connected, cannot publish sensor data");
         return false;
     }
     
     String payload;
-    serializeJson(data, payload);
+    {
+        CpuBoost boost;
+        serializeJson(data, payload);
+    }
     
     Serial.printf("Attempting to publish %d bytes to %s\n", payload.length(), topic.c_str());
     
-    bool success = mqttClient.publish(topic.c_str(), payload.c_str(), true); // Retained message
+    bool success = transport->publish(topic.c_str(), (const uint8_t*)payload.c_str(),
+                                      payload.length(), retained);
     
     if (success) {
         Serial.printf("Published to %s: %s\n", topic.c_str(), payload.c_str());
     } else {
         Serial.printf("Failed to publish to %s (MQTT state: %d, payload size: %d)\n", 
-                     topic.c_str(), mqttClient.state(), payload.length());
+                     topic.c_str(), transport->state(), payload.length());
     }
     
     return success;
 }
 
 bool PoolMQTTClient::publishStatus(const String& deviceId, const String& status) {
-    JsonDocument doc;
+    JsonDocument doc(&jsonArena);
     doc["device_id"] = deviceId;
     doc["status"] = status;
     doc["timestamp"] = millis();
@@ -143,12 +194,31 @@ bool PoolMQTTClient::publishGatewayMessage(const JsonDocument& data) {
     return publishSensorData(TOPIC_GATEWAY, data);
 }
 
+bool PoolMQTTClient::publishBinary(const String& topic, const uint8_t* payload, size_t length) {
+    if (!isConnected()) {
+        return false;
+    }
+    
+    // Not retained: each binary message is one piece of a stream (e.g. sensor traces)
+    bool success = transport->publish(topic.c_str(), payload, length, false);
+    if (!success) {
+        Serial.printf("Failed to publish %u binary bytes to %s (MQTT state: %d)\n",
+                     (unsigned)length, topic.c_str(), transport->state());
+    }
+    return success;
+}
+
+size_t PoolMQTTClient::maxPayloadLength(const String& topic) {
+    size_t overhead = MQTT_PUBLISH_OVERHEAD + topic.length();
+    return overhead < MQTT_BUFFER_SIZE ? MQTT_BUFFER_SIZE - overhead : 0;
+}
+
 bool PoolMQTTClient::subscribe(const String& topic) {
     if (!isConnected()) {
         return false;
     }
     
-    bool success = mqttClient.subscribe(topic.c_str());
+    bool success = transport->subscribe(topic.c_str());
     if (success) {
         Serial.printf("Subscribed to topic: %s\n", topic.c_str());
     } else {
@@ -159,10 +229,15 @@ bool PoolMQTTClient::subscribe(const String& topic) {
 }
 
 void PoolMQTTClient::setCallback(void (*callback)(char*, uint8_t*, unsigned int)) {
-    mqttClient.setCallback(callback);
+    transport->setCallback(callback);
+}
+
+bool PoolMQTTClient::shouldReconnect() {
+    return !isConnected() && millis() - lastConnectionAttempt > 30000; // Try every 30 seconds
 }
 
 bool PoolMQTTClient::reconnect() {
+    lastConnectionAttempt = millis();
     Serial.println("Attempting MQTT reconnection...");
     return connect();
 }
@@ -172,32 +247,15 @@ String PoolMQTTClient::getConnectionStatus() {
         return "WiFi disconnected";
     }
     
-    if (!mqttClient.connected()) {
-        switch (mqttClient.state()) {
-            case MQTT_CONNECTION_TIMEOUT:
-                return "MQTT connection timeout";
-            case MQTT_CONNECTION_LOST:
-                return "MQTT connection lost";
-            case MQTT_CONNECT_FAILED:
-                return "MQTT connect failed";
-            case MQTT_DISCONNECTED:
-                return "MQTT disconnected";
-            case MQTT_CONNECT_BAD_PROTOCOL:
-                return "MQTT bad protocol";
-            case MQTT_CONNECT_BAD_CLIENT_ID:
-                return "MQTT bad client ID";
-            case MQTT_CONNECT_UNAVAILABLE:
-                return "MQTT server unavailable";
-            case MQTT_CONNECT_BAD_CREDENTIALS:
-                return "MQTT bad credentials";
-            case MQTT_CONNECT_UNAUTHORIZED:
-                return "MQTT unauthorized";
-            default:
-                return "MQTT unknown error";
-        }
-    }
-    
-    return "Connected";
+    return transport->describeState();
+}
+
+unsigned long PoolMQTTClient::getTlsHandshakeMs() const {
+    return tlsClient ? tlsClient->getLastHandshakeMs() : 0;
+}
+
+bool PoolMQTTClient::isTlsSessionResumed() const {
+    return tlsClient ? tlsClient->wasSessionResumed() : false;
 }
 
 bool PoolMQTTClient::connectToWiFi() {
@@ -209,7 +267,7 @@ bool PoolMQTTClient::connectToWiFi() {
     WiFi.setHostname("pool-node-001");
     
     // Try each network in the list
-    for (int i = 0; WIFI_NETWORKS[i][0] != nullptr; i++) {
+    for (int i = 0; WIFI_NETWORKS[i][0] != nullptr && !cycleBudget.expired(); i++) {
         const char* ssid = WIFI_NETWORKS[i][0];
         const char* password = WIFI_NETWORKS[i][1];
         
@@ -218,7 +276,8 @@ bool PoolMQTTClient::connectToWiFi() {
         
         unsigned long startTime = millis();
         while (WiFi.status() != WL_CONNECTED && 
-               millis() - startTime < WIFI_TIMEOUT_MS) {
+               millis() - startTime < WIFI_TIMEOUT_MS &&
+               !cycleBudget.expired()) {
             delay(500);
             Serial.print(".");
         }
@@ -240,6 +299,11 @@ bool PoolMQTTClient::connectToWiFi() {
 }
 
 String PoolMQTTClient::createClientId() {
+#if MQTT_TRANSPORT == MQTT_TRANSPORT_MQTT5 && MQTT_PERSISTENT_SESSION
+    // Persistent sessions are keyed by client ID, so it must survive reboots
+    String id = String(MQTT_CLIENT_ID) + "-" + DEVICE_ID;
+#else
     String id = String(MQTT_CLIENT_ID) + "-" + String(random(0xffff), HEX);
+#endif
     return id;
 }
\ No newline at end of file
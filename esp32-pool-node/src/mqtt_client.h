@@ -2,8 +2,10 @@
 #define MQTT_CLIENT_H
 
 #include <WiFi.h>
-#include <PubSubClient.h>
 #include <ArduinoJson.h>
+#include "mqtt_transport.h"
+#include "tls_client.h"
+#include "config.h"
 
 class PoolMQTTClient {
 public:
@@ -12,25 +14,36 @@ public:
     bool initialize();
     bool connect();
     bool isConnected();
-    void disconnect();
+    void disconnect(unsigned long timeoutMs = MQTT_ACK_TIMEOUT_MS); // Acks for the "offline" status get at most timeoutMs
     void loop(); // Call regularly to maintain connection
+    bool flush(unsigned long timeoutMs); // Wait for outstanding QoS1 acknowledgements
+    bool waitForIncoming(unsigned long timeoutMs); // Block on the socket until data or timeout
     
     // Publishing methods
-    bool publishSensorData(const String& topic, const JsonDocument& data);
+    // Latest-value topics are retained; streams and replies (history, acks) are not
+    bool publishSensorData(const String& topic, const JsonDocument& data, bool retained = true);
     bool publishStatus(const String& deviceId, const String& status);
     bool publishGatewayMessage(const JsonDocument& data);
+    bool publishBinary(const String& topic, const uint8_t* payload, size_t length);
+    static size_t maxPayloadLength(const String& topic); // Largest payload either transport can send
     
     // Subscription methods  
     bool subscribe(const String& topic);
     void setCallback(void (*callback)(char*, uint8_t*, unsigned int));
     
     // Connection management
+    bool shouldReconnect(); // Disconnected and the retry interval has passed
     bool reconnect();
     String getConnectionStatus();
     
+    // TLS handshake telemetry (0 / false when TLS is disabled)
+    unsigned long getTlsHandshakeMs() const;
+    bool isTlsSessionResumed() const;
+    
 private:
     WiFiClient wifiClient;
-    PubSubClient mqttClient;
+    TlsClient* tlsClient;
+    MqttTransport* transport;
     
     String clientId;
     unsigned long lastConnectionAttempt;
@@ -0,0 +1,91 @@
+#include "mqtt_transport.h"
+#include "config.h"
+
+#define PUBSUB_SOCKET_TIMEOUT_S 10
+
+// PubSubTransport Implementation
+PubSubTransport::PubSubTransport(Client& client)
+    : mqttClient(client), connectTimeoutS(PUBSUB_SOCKET_TIMEOUT_S) {
+}
+
+void PubSubTransport::setServer(const char* host, uint16_t port) {
+    mqttClient.setServer(host, port);
+    mqttClient.setSocketTimeout(PUBSUB_SOCKET_TIMEOUT_S);
+
+    // Increase buffer size for larger messages (default is 256 bytes)
+    mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
+}
+
+void PubSubTransport::setKeepAlive(uint16_t seconds) {
+    mqttClient.setKeepAlive(seconds);
+}
+
+bool PubSubTransport::connect(const char* clientId, const char* username, const char* password) {
+    // PubSubClient waits for CONNACK up to the socket timeout
+    mqttClient.setSocketTimeout(connectTimeoutS);
+    bool connected = strlen(username) > 0 ? mqttClient.connect(clientId, username, password)
+                                          : mqttClient.connect(clientId);
+    mqttClient.setSocketTimeout(PUBSUB_SOCKET_TIMEOUT_S);
+    return connected;
+}
+
+void PubSubTransport::setConnectTimeout(unsigned long timeoutMs) {
+    // Whole seconds only; round up so a short budget still gets one try
+    unsigned long seconds = (timeoutMs + 999) / 1000;
+    connectTimeoutS = seconds > 0 ? seconds : 1;
+}
+
+bool PubSubTransport::connected() {
+    return mqttClient.connected();
+}
+
+void PubSubTransport::disconnect() {
+    mqttClient.disconnect();
+}
+
+bool PubSubTransport::loop() {
+    return mqttClient.loop();
+}
+
+bool PubSubTransport::publish(const char* topic, const uint8_t* payload, size_t length, bool retained) {
+    return mqttClient.publish(topic, payload, length, retained);
+}
+
+bool PubSubTransport::subscribe(const char* topic) {
+    return mqttClient.subscribe(topic);
+}
+
+void PubSubTransport::setCallback(MqttCallback callback) {
+    mqttClient.setCallback(callback);
+}
+
+int PubSubTransport::state() {
+    return mqttClient.state();
+}
+
+String PubSubTransport::describeState() {
+    switch (mqttClient.state()) {
+        case MQTT_CONNECTED:
+            return "Connected";
+        case MQTT_CONNECTION_TIMEOUT:
+            return "MQTT connection timeout";
+        case MQTT_CONNECTION_LOST:
+            return "MQTT connection lost";
+        case MQTT_CONNECT_FAILED:
+            return "MQTT connect failed";
+        case MQTT_DISCONNECTED:
+            return "MQTT disconnected";
+        case MQTT_CONNECT_BAD_PROTOCOL:
+            return "MQTT bad protocol";
+        case MQTT_CONNECT_BAD_CLIENT_ID:
+            return "MQTT bad client ID";
+        case MQTT_CONNECT_UNAVAILABLE:
+            return "MQTT server unavailable";
+        case MQTT_CONNECT_BAD_CREDENTIALS:
+            return "MQTT bad credentials";
+        case MQTT_CONNECT_UNAUTHORIZED:
+            return "MQTT unauthorized";
+        default:
+            return "MQTT unknown error";
+    }
+}
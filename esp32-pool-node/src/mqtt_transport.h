@@ -0,0 +1,67 @@
+#ifndef MQTT_TRANSPORT_H
+#define MQTT_TRANSPORT_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <PubSubClient.h>
+
+typedef void (*MqttCallback)(char*, uint8_t*, unsigned int);
+
+// Base class for the wire-level MQTT implementations used by PoolMQTTClient
+class MqttTransport {
+public:
+    virtual ~MqttTransport() = default;
+
+    virtual void setServer(const char* host, uint16_t port) = 0;
+    virtual void setKeepAlive(uint16_t seconds) = 0;
+    virtual bool connect(const char* clientId, const char* username, const char* password) = 0;
+    virtual bool connected() = 0;
+    virtual void disconnect() = 0;
+    virtual bool loop() = 0;
+    // Longest wait for the broker's CONNACK in the next connect()
+    virtual void setConnectTimeout(unsigned long timeoutMs) = 0;
+
+    virtual bool publish(const char* topic, const uint8_t* payload, size_t length, bool retained) = 0;
+    virtual bool subscribe(const char* topic) = 0;
+    virtual void setCallback(MqttCallback callback) = 0;
+
+    // Wait until every QoS1 publish has been acknowledged (no-op for QoS0 transports)
+    virtual bool flush(unsigned long /*timeoutMs*/) { return true; }
+    virtual size_t inFlight() const { return 0; }
+
+    // Received bytes held in memory (by the transport or its client) that
+    // select() on the socket cannot see; loop() should run before blocking
+    virtual bool hasBufferedData() { return false; }
+
+    virtual int state() = 0;
+    virtual String describeState() = 0;
+    virtual String getName() const = 0;
+};
+
+// Synchronous QoS0 transport backed by PubSubClient (MQTT 3.1.1)
+class PubSubTransport : public MqttTransport {
+public:
+    explicit PubSubTransport(Client& client);
+
+    void setServer(const char* host, uint16_t port) override;
+    void setKeepAlive(uint16_t seconds) override;
+    bool connect(const char* clientId, const char* username, const char* password) override;
+    bool connected() override;
+    void disconnect() override;
+    bool loop() override;
+    void setConnectTimeout(unsigned long timeoutMs) override;
+
+    bool publish(const char* topic, const uint8_t* payload, size_t length, bool retained) override;
+    bool subscribe(const char* topic) override;
+    void setCallback(MqttCallback callback) override;
+
+    int state() override;
+    String describeState() override;
+    String getName() const override { return "pubsub"; }
+
+private:
+    PubSubClient mqttClient;
+    uint16_t connectTimeoutS;
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "node_config.h"
+#include <Preferences.h>
+#include <stddef.h>
+#include <math.h>
+
+enum FieldType {
+    FIELD_U8,
+    FIELD_U16,
+    FIELD_U32,
+    FIELD_FLOAT
+};
+
+struct FieldSpec {
+    const char* key;
+    FieldType type;
+    size_t offset;
+    double min;
+    double max;
+};
+
+// Worst case of the acquire phase: the full float debounce, then every temperature attempt
+static unsigned long acquireMs(unsigned long floatSwitchSamples, unsigned long temperatureRetries) {
+    return floatSwitchSamples * FLOAT_SWITCH_SAMPLE_MS + temperatureRetries * TEMPERATURE_ATTEMPT_MS;
+}
+
+static_assert(FLOAT_SWITCH_SAMPLES * FLOAT_SWITCH_SAMPLE_MS + SENSOR_READ_RETRIES * TEMPERATURE_ATTEMPT_MS <=
+              BUDGET_ACQUIRE_MS, "Default float samples and temperature retries must fit BUDGET_ACQUIRE_MS");
+
+static const FieldSpec FIELDS[] = {
+    {"sleep_duration",           FIELD_U32,   offsetof(NodeSettings, sleepDurationS),         10, 86400},
+    {"temperature_retries",      FIELD_U8,    offsetof(NodeSettings, temperatureRetries),      1, 5},
+    {"float_switch_samples",     FIELD_U16,   offsetof(NodeSettings, floatSwitchSamples),      1,
+     (BUDGET_ACQUIRE_MS - TEMPERATURE_ATTEMPT_MS) / FLOAT_SWITCH_SAMPLE_MS},
+    {"low_battery_v",            FIELD_FLOAT, offsetof(NodeSettings, lowBatteryV),             3.0, 4.2},
+    {"critical_battery_v",       FIELD_FLOAT, offsetof(NodeSettings, criticalBatteryV),        2.8, 4.0},
+    {"sensor_failure_threshold", FIELD_U8,    offsetof(NodeSettings, sensorFailureThreshold),  1, 20},
+    {"sensor_backoff_initial_s", FIELD_U16,   offsetof(NodeSettings, sensorBackoffInitialS),   10, 3600},
+    {"sensor_backoff_max_s",     FIELD_U16,   offsetof(NodeSettings, sensorBackoffMaxS),       60, 43200},
+    {"log_level",                FIELD_U8,    offsetof(NodeSettings, logLevel),                0, 5},
+};
+
+static double readField(const NodeSettings& settings, const FieldSpec& field) {
+    const uint8_t* base = (const uint8_t*)&settings + field.offset;
+    switch (field.type) {
+        case FIELD_U8: return *(const uint8_t*)base;
+        case FIELD_U16: return *(const uint16_t*)base;
+        case FIELD_U32: return *(const uint32_t*)base;
+        default: return *(const float*)base;
+    }
+}
+
+static void writeField(NodeSettings& settings, const FieldSpec& field, double value) {
+    uint8_t* base = (uint8_t*)&settings + field.offset;
+    switch (field.type) {
+        case FIELD_U8: *(uint8_t*)base = (uint8_t)value; break;
+        case FIELD_U16: *(uint16_t*)base = (uint16_t)value; break;
+        case FIELD_U32: *(uint32_t*)base = (uint32_t)value; break;
+        default: *(float*)base = (float)value; break;
+    }
+}
+
+// Float fields are compared at float precision, so a bound like 2.8 is itself in range
+static bool inRange(const FieldSpec& field, double value) {
+    if (field.type == FIELD_FLOAT) {
+        return (float)value >= (float)field.min && (float)value <= (float)field.max;
+    }
+    return value >= field.min && value <= field.max;
+}
+
+// Global instance
+NodeConfig nodeConfig;
+
+// NodeConfig Implementation
+void NodeConfig::begin() {
+    settings = defaults();
+
+    Preferences preferences;
+    if (!preferences.begin("node_cfg", true)) {
+        Serial.println("Node config: no stored settings, using defaults");
+        return;
+    }
+
+    NodeSettings stored;
+    bool loaded = preferences.getBytesLength("settings") == sizeof(stored) &&
+                  preferences.getBytes("settings", &stored, sizeof(stored)) == sizeof(stored) &&
+                  stored.version == NODE_CONFIG_VERSION && isConsistent(stored);
+    preferences.end();
+
+    if (loaded) {
+        settings = stored;
+        Serial.printf("Node config: revision %lu loaded from NVS\n", (unsigned long)settings.revision);
+    } else {
+        Serial.println("Node config: stored settings missing or from another version, using defaults");
+    }
+}
+
+size_t NodeConfig::apply(JsonObjectConst update, uint32_t revision, JsonObject applied, JsonArray rejected) {
+    NodeSettings candidate = settings;
+    size_t changed = 0;
+
+    for (const FieldSpec& field : FIELDS) {
+        JsonVariantConst value = update[field.key];
+        if (value.isNull()) {
+            continue;
+        }
+
+        double number = value.as<double>();
+        bool integral = field.type != FIELD_FLOAT;
+        if (!value.is<double>() || !inRange(field, number) || (integral && number != floor(number))) {
+            rejected.add(field.key);
+            continue;
+        }
+
+        // Compare after conversion so 3.3 does not differ from the stored float
+        double before = readField(candidate, field);
+        writeField(candidate, field, number);
+        if (readField(candidate, field) != before) {
+            applied[field.key] = value;
+            changed++;
+        }
+    }
+
+    if (changed > 0 && !isConsistent(candidate)) {
+        for (JsonPair pair : applied) {
+            rejected.add(pair.key());
+        }
+        applied.clear();
+        candidate = settings;
+        changed = 0;
+    }
+
+    if (revision != 0) {
+        candidate.revision = revision;
+    }
+    if (changed == 0 && candidate.revision == settings.revision) {
+        return 0;
+    }
+
+    settings = candidate;
+    if (!save()) {
+        Serial.println("WARNING: node config applied but not saved to NVS");
+    }
+    Serial.printf("Node config: revision %lu, %u fields changed\n", (unsigned long)settings.revision, (unsigned)changed);
+    return changed;
+}
+
+void NodeConfig::report(JsonObject out) const {
+    out["rev"] = settings.revision;
+    for (const FieldSpec& field : FIELDS) {
+        if (field.type == FIELD_FLOAT) {
+            out[field.key] = (float)readField(settings, field);
+        } else {
+            out[field.key] = (uint32_t)readField(settings, field);
+        }
+    }
+}
+
+NodeSettings NodeConfig::defaults() {
+    NodeSettings values = {};
+    values.version = NODE_CONFIG_VERSION;
+    values.sleepDurationS = DEFAULT_SLEEP_DURATION_S;
+    values.temperatureRetries = SENSOR_READ_RETRIES;
+    values.floatSwitchSamples = FLOAT_SWITCH_SAMPLES;
+    values.lowBatteryV = LOW_BATTERY_THRESHOLD;
+    values.criticalBatteryV = CRITICAL_BATTERY_THRESHOLD;
+    values.sensorFailureThreshold = SENSOR_FAILURE_THRESHOLD;
+    values.sensorBackoffInitialS = SENSOR_BACKOFF_INITIAL_S;
+    values.sensorBackoffMaxS = SENSOR_BACKOFF_MAX_S;
+    values.logLevel = DEFAULT_LOG_LEVEL;
+    return values;
+}
+
+bool NodeConfig::isConsistent(const NodeSettings& candidate) {
+    for (const FieldSpec& field : FIELDS) {
+        if (!inRange(field, readField(candidate, field))) {
+            return false;
+        }
+    }
+    return candidate.criticalBatteryV < candidate.lowBatteryV &&
+           candidate.sensorBackoffInitialS <= candidate.sensorBackoffMaxS &&
+           acquireMs(candidate.floatSwitchSamples, candidate.temperatureRetries) <= BUDGET_ACQUIRE_MS;
+}
+
+bool NodeConfig::save() {
+    Preferences preferences;
+    if (!preferences.begin("node_cfg", false)) {
+        return false;
+    }
+    bool saved = preferences.putBytes("settings", &settings, sizeof(settings)) == sizeof(settings);
+    preferences.end();
+    return saved;
+}
@@ -0,0 +1,56 @@
+#ifndef NODE_CONFIG_H
+#define NODE_CONFIG_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+#define NODE_CONFIG_VERSION 1   // Bump whenever NodeSettings changes layout
+
+// Settings that can be changed remotely; the defaults come from config.h
+struct NodeSettings {
+    uint16_t version;               // NODE_CONFIG_VERSION
+    uint32_t revision;              // Mailbox revision last applied, 0 = never configured
+    uint32_t sleepDurationS;
+    uint8_t temperatureRetries;
+    uint16_t floatSwitchSamples;
+    float lowBatteryV;
+    float criticalBatteryV;
+    uint8_t sensorFailureThreshold;
+    uint16_t sensorBackoffInitialS;
+    uint16_t sensorBackoffMaxS;
+    uint8_t logLevel;               // esp_log_level_t: 0 none ... 5 verbose
+};
+
+// Typed, versioned node configuration persisted in NVS.
+// Updates are JSON objects keyed by field name ("sleep_duration",
+// "low_battery_v", ...). Each field has a type and range; only fields whose
+// value actually differs are applied, and nothing is applied if the result
+// is inconsistent (e.g. critical battery voltage above the low one). A
+// stored blob from another NODE_CONFIG_VERSION is ignored in favour of the
+// defaults, like probe calibrations.
+class NodeConfig {
+public:
+    void begin();
+    const NodeSettings& get() const { return settings; }
+
+    // Applies the fields of `update` that differ from the current settings and
+    // saves them together with `revision` (0 keeps the current revision).
+    // Changed fields are echoed into `applied`, invalid ones listed in `rejected`.
+    // Returns the number of fields applied.
+    size_t apply(JsonObjectConst update, uint32_t revision, JsonObject applied, JsonArray rejected);
+
+    // Every field with its current value
+    void report(JsonObject out) const;
+
+private:
+    NodeSettings settings;
+
+    static NodeSettings defaults();
+    static bool isConsistent(const NodeSettings& candidate);
+    bool save();
+};
+
+extern NodeConfig nodeConfig;
+
+#endif
@@ -0,0 +1,95 @@
+#include "payloads.h"
+#include "config.h"
+#include "json_arena.h"
+#include "cycle_budget.h"
+#include "sensor_health.h"
+
+void buildGatewayMessage(JsonDocument& msg, const GatewayStatus& status,
+                         const JsonDocument& tempData, const JsonDocument& batteryData) {
+    // Device information
+    msg["device_id"] = DEVICE_ID;
+    msg["device_type"] = DEVICE_TYPE;
+    msg["timestamp"] = millis();
+    msg["firmware_version"] = FIRMWARE_VERSION;
+    
+    // Reading sequence; numbers below seq_epoch were lost with a power cycle
+    msg["seq"] = status.sequence;
+    msg["seq_epoch"] = status.sequenceEpoch;
+    
+    // Mailbox revision the running settings came from
+    msg["config_rev"] = status.configRevision;
+    
+    // System status  
+    msg["uptime_ms"] = millis();
+    msg["free_heap"] = status.freeHeap;
+    msg["wifi_rssi"] = status.wifiRssi;
+    msg["connection_status"] = status.connectionStatus;
+    
+    // TLS handshake cost for this wake (abbreviated when the RTC session cache hits)
+    if (status.tlsHandshakeMs > 0) {
+        JsonObject tls = msg["tls"].to<JsonObject>();
+        tls["handshake_ms"] = status.tlsHandshakeMs;
+        tls["resumed"] = status.tlsResumed;
+    }
+    
+    // JSON arena usage (high-water mark of the previous cycle, this cycle so far)
+    JsonObject arena = msg["json_arena"].to<JsonObject>();
+    arena["size"] = jsonArena.getCapacity();
+    arena["last_peak"] = jsonArena.getLastCycleHighWaterMark();
+    arena["peak"] = jsonArena.getHighWaterMark();
+    arena["overflows"] = jsonArena.getOverflowCount();
+    
+    // Sensor availability
+    JsonObject sensors = msg["sensors"].to<JsonObject>();
+    sensors["temperature_available"] = status.temperatureAvailable;
+    sensors["water_level_available"] = status.waterLevelAvailable;
+    sensors["battery_available"] = status.batteryAvailable;
+    
+    // Wake-cycle phase timing (last completed run of each phase) and overruns
+    JsonObject cycle = msg["cycle"].to<JsonObject>();
+    JsonArray phaseMs = cycle["phase_ms"].to<JsonArray>();
+    JsonArray overruns = cycle["overruns"].to<JsonArray>();
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        phaseMs.add(cycleBudget.getLastDurationMs((CyclePhase)phase));
+        overruns.add(cycleBudget.getOverrunCount((CyclePhase)phase));
+    }
+    cycle["buffered"] = readingBuffer.count();
+    cycle["dropped"] = readingBuffer.getDroppedCount();
+    
+    // Circuit breaker state and time lost to failing sensors
+    sensorHealth.report(msg["health"].to<JsonObject>(), getNodeClockS());
+    
+    // Quick sensor readings (for gateway summary), taken this cycle
+    if (tempData["value"].is<float>()) {
+        msg["temperature_f"] = tempData["value"];
+    }
+    
+    if (batteryData["value"].is<float>()) {
+        msg["battery_voltage"] = batteryData["value"];
+    }
+    if (batteryData["percentage"].is<float>()) {
+        msg["battery_percentage"] = batteryData["percentage"];
+    }
+}
+
+JsonArray beginHistoryMessage(JsonDocument& history, uint32_t nowS) {
+    history["device_id"] = DEVICE_ID;
+    history["now_s"] = nowS;
+    return history["readings"].to<JsonArray>();
+}
+
+void addHistoryEntry(JsonArray readings, const BufferedReading& reading) {
+    JsonObject entry = readings.add<JsonObject>();
+    entry["seq"] = reading.sequence;
+    entry["t"] = reading.timestampS;
+    if (reading.flags & READING_HAS_TEMPERATURE) {
+        entry["temperature_f"] = reading.temperatureCentiF / 100.0f;
+    }
+    if (reading.flags & READING_HAS_WATER_LEVEL) {
+        entry["water_level"] = (reading.flags & READING_WATER_OK) != 0;
+    }
+    if (reading.flags & READING_HAS_BATTERY) {
+        entry["battery_voltage"] = reading.batteryMv / 1000.0f;
+        entry["battery_percentage"] = reading.batteryPercent;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef PAYLOADS_H
+#define PAYLOADS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "reading_buffer.h"
+
+// Gateway message inputs owned by the radio, MQTT and NVS layers
+struct GatewayStatus {
+    uint32_t sequence;
+    uint32_t sequenceEpoch;         // Numbers below it were lost with a power cycle
+    uint32_t configRevision;        // Mailbox revision the running settings came from
+    uint32_t freeHeap;
+    int wifiRssi;                   // -99 when WiFi is down
+    String connectionStatus;
+    unsigned long tlsHandshakeMs;   // 0 without TLS
+    bool tlsResumed;
+    bool temperatureAvailable;
+    bool waterLevelAvailable;
+    bool batteryAvailable;
+};
+
+// Message documents shared by main.cpp and the payload benchmarks, so the
+// benchmarks measure exactly what the node sends. Host-buildable: besides the
+// arguments, only the JSON arena, cycle budget, reading buffer and sensor
+// health state are read.
+
+// poolio/gateway without the platform-only parts (power, analog probes), which main.cpp adds
+void buildGatewayMessage(JsonDocument& msg, const GatewayStatus& status,
+                         const JsonDocument& tempData, const JsonDocument& batteryData);
+
+// poolio/history envelope; returns the "readings" array for addHistoryEntry()
+JsonArray beginHistoryMessage(JsonDocument& history, uint32_t nowS);
+void addHistoryEntry(JsonArray readings, const BufferedReading& reading);
+
+#endif
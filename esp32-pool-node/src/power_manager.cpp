@@ -0,0 +1,200 @@
+#include "power_manager.h"
+#include "config.h"
+#include "mqtt_client.h"
+#include <WiFi.h>
+#include <esp_pm.h>
+#include <esp_idf_version.h>
+
+static const uint32_t FREQ_STEPS_MHZ[CPU_FREQ_STEP_COUNT] = {40, 80, 160, 240};
+
+// CPU clock under an ESP_PM_APB_FREQ_MAX lock
+static const uint32_t PM_APB_MAX_MHZ = 80;
+
+static const uint32_t PHASE_FREQ_MHZ[PHASE_COUNT] = {
+    CPU_FREQ_ACQUIRE_MHZ,
+    CPU_FREQ_CONNECT_MHZ,
+    CPU_FREQ_PUBLISH_MHZ,
+    CPU_FREQ_DRAIN_MHZ
+};
+
+static int stepIndex(uint32_t mhz) {
+    int index = 0;
+    while (index < CPU_FREQ_STEP_COUNT - 1 && FREQ_STEPS_MHZ[index + 1] <= mhz) {
+        index++;
+    }
+    return index;
+}
+
+// Global instance
+PowerManager powerManager;
+
+// PowerManager Implementation
+void PowerManager::beginFrequencyScaling() {
+    currentMhz = getCpuFrequencyMhz();
+    lastChangeUs = micros();
+
+#if CPU_FREQ_SCALING_ENABLED
+    scaling = true;
+    cycleBudget.setPhaseListener(onPhaseChange);
+    setBaseFrequency(CPU_FREQ_IDLE_MHZ);
+    Serial.printf("CPU frequency scaling: %lu MHz idle, %d MHz boost\n",
+                 (unsigned long)currentMhz, CPU_FREQ_BOOST_MHZ);
+#endif
+}
+
+void PowerManager::onPhaseChange(CyclePhase phase, bool active) {
+    powerManager.inPhase = active;
+    powerManager.setBaseFrequency(active ? PHASE_FREQ_MHZ[phase] : CPU_FREQ_IDLE_MHZ);
+}
+
+void PowerManager::setBaseFrequency(uint32_t mhz) {
+    baseMhz = mhz;
+    applyFrequency();
+}
+
+void PowerManager::acquireBoost() {
+    if (!scaling) {
+        return;
+    }
+    if (boostDepth++ == 0) {
+        if (pmBoostLock) {
+            esp_pm_lock_acquire((esp_pm_lock_handle_t)pmBoostLock);
+        }
+        applyFrequency();
+    }
+}
+
+void PowerManager::releaseBoost() {
+    if (!scaling || boostDepth == 0) {
+        return;
+    }
+    if (--boostDepth == 0) {
+        if (pmBoostLock) {
+            esp_pm_lock_release((esp_pm_lock_handle_t)pmBoostLock);
+        }
+        applyFrequency();
+    }
+}
+
+void PowerManager::applyFrequency() {
+    if (!scaling) {
+        return;
+    }
+    uint32_t target = baseMhz;
+    if (pmBoostLock) {
+        // Outside phases nothing is held, so DFS can drop to the minimum and light-sleep
+        target = lockStep(inPhase ? baseMhz : 0);
+    }
+    if (boostDepth > 0) {
+        target = CPU_FREQ_BOOST_MHZ;
+    }
+    if (target == currentMhz) {
+        return;
+    }
+
+    accountTime();
+    if (!pmBoostLock) {
+        setCpuFrequencyMhz(target);
+    }
+    currentMhz = target;
+}
+
+// Holds the esp_pm lock that keeps the clock at or above `mhz` and returns the
+// clock DFS runs at with it: the maximum, the APB clock or the minimum.
+// WiFi's own locks can still raise the clock while nothing is held.
+uint32_t PowerManager::lockStep(uint32_t mhz) {
+    void* wanted = nullptr;
+    uint32_t lockedMhz = LIGHT_SLEEP_MIN_FREQ_MHZ;
+    if (mhz > PM_APB_MAX_MHZ) {
+        wanted = pmCpuStepLock;
+        lockedMhz = CPU_FREQ_BOOST_MHZ;
+    } else if (mhz > LIGHT_SLEEP_MIN_FREQ_MHZ) {
+        wanted = pmApbStepLock;
+        lockedMhz = PM_APB_MAX_MHZ;
+    }
+
+    if (wanted != pmHeldStepLock) {
+        if (wanted) {
+            esp_pm_lock_acquire((esp_pm_lock_handle_t)wanted);
+        }
+        if (pmHeldStepLock) {
+            esp_pm_lock_release((esp_pm_lock_handle_t)pmHeldStepLock);
+        }
+        pmHeldStepLock = wanted;
+    }
+    return lockedMhz;
+}
+
+void PowerManager::accountTime() {
+    unsigned long now = micros();
+    timeAtStepUs[stepIndex(currentMhz)] += now - lastChangeUs;
+    lastChangeUs = now;
+}
+
+void PowerManager::reportFrequencyTime(JsonObject out) {
+    accountTime();
+    for (int i = 0; i < CPU_FREQ_STEP_COUNT; i++) {
+        if (timeAtStepUs[i] > 0) {
+            out[String(FREQ_STEPS_MHZ[i])] = (unsigned long)(timeAtStepUs[i] / 1000);
+        }
+    }
+}
+
+bool PowerManager::beginLightSleep() {
+    // Modem sleep: the radio only wakes for beacons (every DTIM with MIN_MODEM)
+    WiFi.setSleep(LIGHT_SLEEP_WIFI_PS);
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t pmConfig = {};
+#else
+    esp_pm_config_esp32s3_t pmConfig = {};
+#endif
+    pmConfig.max_freq_mhz = scaling ? CPU_FREQ_BOOST_MHZ : getCpuFrequencyMhz();
+    pmConfig.min_freq_mhz = LIGHT_SLEEP_MIN_FREQ_MHZ;
+    pmConfig.light_sleep_enable = true;
+
+    esp_err_t err = esp_pm_configure(&pmConfig);
+    esp_err_t dfsErr = err;
+    if (err != ESP_OK) {
+        // Automatic light sleep needs CONFIG_PM_ENABLE and tickless idle in the core's sdkconfig
+        pmConfig.light_sleep_enable = false;
+        dfsErr = esp_pm_configure(&pmConfig);
+        Serial.printf("Automatic light sleep unavailable (%s), using modem sleep only\n", esp_err_to_name(err));
+    }
+
+    // From here on DFS owns the clock; boosts and phase steps become esp_pm locks
+    esp_pm_lock_handle_t boostLock;
+    esp_pm_lock_handle_t cpuStepLock;
+    esp_pm_lock_handle_t apbStepLock;
+    if (scaling && dfsErr == ESP_OK &&
+        esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "cpu_boost", &boostLock) == ESP_OK &&
+        esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "cpu_step", &cpuStepLock) == ESP_OK &&
+        esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "apb_step", &apbStepLock) == ESP_OK) {
+        pmBoostLock = boostLock;
+        pmCpuStepLock = cpuStepLock;
+        pmApbStepLock = apbStepLock;
+        if (boostDepth > 0) {
+            esp_pm_lock_acquire(boostLock);
+        }
+        applyFrequency();
+    }
+
+    autoLightSleep = err == ESP_OK;
+    if (!autoLightSleep) {
+        return false;
+    }
+
+    Serial.printf("Light-sleep mode active: CPU %d-%lu MHz, WiFi power save %d\n",
+                 LIGHT_SLEEP_MIN_FREQ_MHZ, (unsigned long)pmConfig.max_freq_mhz, (int)LIGHT_SLEEP_WIFI_PS);
+    return true;
+}
+
+bool PowerManager::idle(PoolMQTTClient& client, unsigned long maxMs) {
+    unsigned long start = millis();
+    bool woken = client.waitForIncoming(maxMs);
+    idleMs += millis() - start;
+    if (woken) {
+        dataWakeups++;
+    }
+    return woken;
+}
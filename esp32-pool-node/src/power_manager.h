@@ -0,0 +1,85 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "cycle_budget.h"
+
+class PoolMQTTClient;
+
+// CPU frequency steps reported in the gateway message
+#define CPU_FREQ_STEP_COUNT 4
+
+// Power management for the awake node.
+//
+// Frequency scaling: each wake-cycle phase runs at its CPU_FREQ_*_MHZ step
+// (80 MHz by default, since acquire, connect and drain are I/O-bound) and
+// CpuBoost scopes raise the clock to CPU_FREQ_BOOST_MHZ only around TLS,
+// serialization and filtering. Without esp_pm the clock is switched with
+// setCpuFrequencyMhz(); once esp_pm is running (light-sleep mode) boosts and
+// phase steps become esp_pm locks and DFS picks the clock outside phases.
+//
+// Light-sleep continuous mode (POWER_MODE_LIGHT_SLEEP): between sensor
+// cycles the loop blocks on the MQTT socket instead of spinning on delay().
+// With automatic light sleep enabled, FreeRTOS idles the CPU in light sleep
+// while the radio wakes for every DTIM beacon (modem sleep), so the broker
+// connection and the TOPIC_CONFIG subscription stay up and downlink messages
+// are handled as soon as they arrive.
+class PowerManager {
+public:
+    // Call once in setup(); hooks the cycle budget's phase changes
+    void beginFrequencyScaling();
+    void acquireBoost();
+    void releaseBoost();
+    uint32_t getCurrentMhz() const { return currentMhz; }
+
+    // Milliseconds spent at each step since boot ({"80": ms, "240": ms, ...})
+    void reportFrequencyTime(JsonObject out);
+
+    // Call once WiFi is up. Returns false if automatic light sleep is not
+    // available in this core build; modem sleep and frequency scaling still apply.
+    bool beginLightSleep();
+
+    // Blocks until MQTT data arrives or `maxMs` elapses; true if woken by data
+    bool idle(PoolMQTTClient& client, unsigned long maxMs);
+
+    bool isAutoLightSleepEnabled() const { return autoLightSleep; }
+    unsigned long getIdleMs() const { return idleMs; }
+    unsigned long getDataWakeups() const { return dataWakeups; }
+
+private:
+    bool autoLightSleep = false;
+    unsigned long idleMs = 0;
+    unsigned long dataWakeups = 0;
+
+    bool scaling = false;
+    void* pmBoostLock = nullptr;    // esp_pm_lock_handle_t once esp_pm is configured
+    void* pmCpuStepLock = nullptr;  // Phase steps above the APB clock
+    void* pmApbStepLock = nullptr;  // Phase steps at the APB clock
+    void* pmHeldStepLock = nullptr;
+    bool inPhase = false;
+    int boostDepth = 0;
+    uint32_t baseMhz = 0;
+    uint32_t currentMhz = 0;
+    unsigned long lastChangeUs = 0;
+    uint64_t timeAtStepUs[CPU_FREQ_STEP_COUNT] = {};
+
+    static void onPhaseChange(CyclePhase phase, bool active);
+    void setBaseFrequency(uint32_t mhz);
+    void applyFrequency();
+    uint32_t lockStep(uint32_t mhz);
+    void accountTime();
+};
+
+extern PowerManager powerManager;
+
+// Holds the CPU at CPU_FREQ_BOOST_MHZ for the enclosing scope; nests
+class CpuBoost {
+public:
+    CpuBoost() { powerManager.acquireBoost(); }
+    ~CpuBoost() { powerManager.releaseBoost(); }
+    CpuBoost(const CpuBoost&) = delete;
+    CpuBoost& operator=(const CpuBoost&) = delete;
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "reading_buffer.h"
+#include <Preferences.h>
+
+// RTC_DATA_ATTR variables are zeroed on power-on, so a cold boot starts empty
+RTC_DATA_ATTR static BufferedReading rtcReadings[READING_BUFFER_CAPACITY];
+RTC_DATA_ATTR static uint16_t rtcHead = 0;    // Index of the oldest reading
+RTC_DATA_ATTR static uint16_t rtcCount = 0;
+RTC_DATA_ATTR static uint16_t rtcPending = 0; // Readings flagged READING_UNSENT
+RTC_DATA_ATTR static uint32_t rtcDropped = 0;
+RTC_DATA_ATTR static uint32_t rtcClockBaseS = 0;
+RTC_DATA_ATTR static uint32_t rtcNextSequence = 0;
+RTC_DATA_ATTR static uint32_t rtcReservedSequence = 0;  // Stored in NVS; numbers below it are taken
+RTC_DATA_ATTR static uint32_t rtcSequenceEpoch = 0;
+
+ReadingBuffer readingBuffer;
+
+static BufferedReading& slot(size_t index) {
+    return rtcReadings[(rtcHead + index) % READING_BUFFER_CAPACITY];
+}
+
+bool ReadingBuffer::push(const BufferedReading& reading, bool pending) {
+    bool overwrote = false;
+    if (rtcCount == READING_BUFFER_CAPACITY) {
+        if (slot(0).flags & READING_UNSENT) {
+            rtcPending--;
+            rtcDropped++;
+            overwrote = true;
+        }
+        rtcHead = (rtcHead + 1) % READING_BUFFER_CAPACITY;
+        rtcCount--;
+    }
+
+    BufferedReading& stored = slot(rtcCount);
+    stored = reading;
+    stored.flags &= ~READING_UNSENT;
+    if (pending) {
+        stored.flags |= READING_UNSENT;
+        rtcPending++;
+    }
+    rtcCount++;
+    return !overwrote;
+}
+
+bool ReadingBuffer::peek(size_t index, BufferedReading& reading) const {
+    for (size_t i = 0; i < rtcCount; i++) {
+        if (!(slot(i).flags & READING_UNSENT)) {
+            continue;
+        }
+        if (index == 0) {
+            reading = slot(i);
+            reading.flags &= ~READING_UNSENT;
+            return true;
+        }
+        index--;
+    }
+    return false;
+}
+
+void ReadingBuffer::pop(size_t count) {
+    for (size_t i = 0; i < rtcCount && count > 0; i++) {
+        if (slot(i).flags & READING_UNSENT) {
+            slot(i).flags &= ~READING_UNSENT;
+            rtcPending--;
+            count--;
+        }
+    }
+}
+
+bool ReadingBuffer::find(uint32_t sequence, BufferedReading& reading) const {
+    for (size_t i = 0; i < rtcCount; i++) {
+        if (slot(i).sequence == sequence) {
+            reading = slot(i);
+            reading.flags &= ~READING_UNSENT;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ReadingBuffer::getOldestSequence(uint32_t& sequence) const {
+    if (rtcCount == 0) {
+        return false;
+    }
+    sequence = slot(0).sequence;
+    return true;
+}
+
+size_t ReadingBuffer::count() const {
+    return rtcPending;
+}
+
+unsigned long ReadingBuffer::getDroppedCount() const {
+    return rtcDropped;
+}
+
+SeriesSample toSeriesSample(const BufferedReading& reading) {
+    SeriesSample sample = {};
+    sample.timestampS = reading.timestampS;
+    sample.sequence = reading.sequence;
+    sample.flags = reading.flags;
+    sample.values[SERIES_TEMPERATURE_F] = reading.temperatureCentiF / 100.0f;
+    sample.values[SERIES_BATTERY_VOLTAGE] = reading.batteryMv / 1000.0f;
+    sample.values[SERIES_BATTERY_PERCENT] = reading.batteryPercent;
+    return sample;
+}
+
+uint32_t takeSequenceNumber() {
+    if (rtcNextSequence >= rtcReservedSequence) {
+        Preferences preferences;
+        if (preferences.begin("uplink", false)) {
+            if (rtcReservedSequence == 0) {
+                // Power-on: continue past everything an earlier boot may have used
+                uint32_t stored = preferences.getUInt("seq_reserved", 0);
+                if (stored > rtcNextSequence) {
+                    rtcNextSequence = stored;
+                }
+                rtcSequenceEpoch = rtcNextSequence;
+            }
+            rtcReservedSequence = rtcNextSequence + SEQUENCE_RESERVE_BLOCK;
+            if (preferences.putUInt("seq_reserved", rtcReservedSequence) == 0) {
+                Serial.println("WARNING: sequence reservation not saved to NVS");
+            }
+            preferences.end();
+        }
+    }
+    return rtcNextSequence++;
+}
+
+uint32_t getSequenceEpoch() {
+    return rtcSequenceEpoch;
+}
+
+uint32_t getNodeClockS() {
+    return rtcClockBaseS + millis() / 1000;
+}
+
+void advanceNodeClockForSleep(uint32_t sleepSeconds) {
+    rtcClockBaseS += millis() / 1000 + sleepSeconds;
+}
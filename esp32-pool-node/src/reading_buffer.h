@@ -0,0 +1,66 @@
+#ifndef READING_BUFFER_H
+#define READING_BUFFER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "series_codec.h"
+
+#define READING_HAS_TEMPERATURE  0x01
+#define READING_HAS_WATER_LEVEL  0x02
+#define READING_WATER_OK         0x04
+#define READING_HAS_BATTERY      0x08
+#define READING_UNSENT           0x80   // Internal to ReadingBuffer, never encoded
+
+static_assert(READING_HAS_TEMPERATURE == SERIES_HAS_TEMPERATURE && READING_HAS_WATER_LEVEL == SERIES_HAS_WATER_LEVEL &&
+              READING_WATER_OK == SERIES_WATER_OK && READING_HAS_BATTERY == SERIES_HAS_BATTERY,
+              "BufferedReading flags must match the series codec");
+
+// One cycle's sensor summary, compact enough to keep dozens in RTC memory
+struct BufferedReading {
+    uint32_t sequence;           // See takeSequenceNumber()
+    uint32_t timestampS;         // Node clock, see getNodeClockS()
+    int16_t temperatureCentiF;
+    uint16_t batteryMv;
+    uint8_t batteryPercent;
+    uint8_t flags;               // READING_* bits
+};
+
+// Ring buffer of the most recent readings. Readings that could not be
+// published (connect or publish budget overrun, broker unreachable) stay
+// pending until a history message carries them; published ones are kept
+// until overwritten so the hub can request them again (backfill). Lives in
+// RTC memory so it survives deep sleep; when full, the oldest reading is
+// overwritten, and counted as dropped if it was still pending.
+class ReadingBuffer {
+public:
+    bool push(const BufferedReading& reading, bool pending);
+    bool peek(size_t index, BufferedReading& reading) const;  // Pending readings, 0 = oldest
+    void pop(size_t count);                                    // Marks the oldest pending readings sent
+
+    // Any kept reading, pending or already published
+    bool find(uint32_t sequence, BufferedReading& reading) const;
+    bool getOldestSequence(uint32_t& sequence) const;
+
+    size_t count() const;   // Pending readings
+    size_t capacity() const { return READING_BUFFER_CAPACITY; }
+    unsigned long getDroppedCount() const;
+};
+
+extern ReadingBuffer readingBuffer;
+
+// Input for SeriesEncoder (HISTORY_FORMAT_SERIES)
+SeriesSample toSeriesSample(const BufferedReading& reading);
+
+// Next per-device reading sequence number. Survives deep sleep in RTC memory
+// and power loss through NVS, where a block of SEQUENCE_RESERVE_BLOCK numbers
+// is reserved at a time so flash is written once per block, not per reading.
+// After a power loss the unused rest of the block is skipped.
+uint32_t takeSequenceNumber();
+// First sequence number since power-on; lower numbers still missing at the hub are gone
+uint32_t getSequenceEpoch();
+
+// Seconds since cold boot, including time spent in deep sleep
+uint32_t getNodeClockS();
+void advanceNodeClockForSleep(uint32_t sleepSeconds);
+
+#endif
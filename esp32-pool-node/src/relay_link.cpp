@@ -0,0 +1,157 @@
+#include "relay_link.h"
+#include "config.h"
+#include "secrets.h"
+#include <WiFi.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+static_assert(sizeof(ESPNOW_PMK) - 1 == ESP_NOW_KEY_LEN, "ESPNOW_PMK must be 16 characters");
+static_assert(sizeof(ESPNOW_LMK) - 1 == ESP_NOW_KEY_LEN, "ESPNOW_LMK must be 16 characters");
+
+static const uint8_t leafMacs[][6] = ESPNOW_LEAF_MACS;
+static const size_t leafMacCount = sizeof(leafMacs) / sizeof(leafMacs[0]);
+
+// All-zero entries are unused allowlist slots
+static bool isUnsetMac(const uint8_t* mac) {
+    static const uint8_t zero[6] = {0};
+    return memcmp(mac, zero, sizeof(zero)) == 0;
+}
+
+static bool isAllowedLeaf(const uint8_t* mac) {
+    for (size_t i = 0; i < leafMacCount; i++) {
+        if (!isUnsetMac(leafMacs[i]) && memcmp(mac, leafMacs[i], 6) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Both ends use the shared keys; frames from anything else fail to decrypt
+static bool addEncryptedPeer(const uint8_t* mac, uint8_t channel) {
+    esp_now_peer_info_t peer = {};
+    memcpy(peer.peer_addr, mac, 6);
+    peer.channel = channel;
+    peer.ifidx = WIFI_IF_STA;
+    peer.encrypt = true;
+    memcpy(peer.lmk, ESPNOW_LMK, ESP_NOW_KEY_LEN);
+    return esp_now_add_peer(&peer) == ESP_OK;
+}
+
+// ESP-NOW callbacks run in the WiFi task, so they only touch these
+static QueueHandle_t rxQueue = nullptr;
+static volatile int sendResult = -1; // -1 pending, otherwise esp_now_send_status_t
+
+static void onEspNowReceive(const uint8_t* mac, const uint8_t* data, int length) {
+    // Plaintext frames are still delivered, so only listed leaves are accepted
+    if (!rxQueue || length <= 0 || length > RELAY_PACKET_MAX_SIZE || !isAllowedLeaf(mac)) {
+        return;
+    }
+
+    RelayFrame frame;
+    memcpy(frame.mac, mac, sizeof(frame.mac));
+    frame.length = length;
+    memcpy(frame.data, data, length);
+    xQueueSend(rxQueue, &frame, 0); // Drop when full rather than block the WiFi task
+}
+
+static void onEspNowSent(const uint8_t* mac, esp_now_send_status_t status) {
+    sendResult = status;
+}
+
+// EspNowLink Implementation
+EspNowLink::EspNowLink(bool gateway) : gateway(gateway) {
+    const uint8_t mac[6] = ESPNOW_GATEWAY_MAC;
+    memcpy(peerMac, mac, sizeof(peerMac));
+}
+
+bool EspNowLink::begin() {
+    if (gateway) {
+        // The gateway is already associated; ESP-NOW shares the AP's channel.
+        // Modem sleep would make it miss leaf frames.
+        WiFi.setSleep(false);
+        Serial.printf("ESP-NOW gateway listening: MAC %s, channel %d\n",
+                     WiFi.macAddress().c_str(), WiFi.channel());
+    } else {
+        WiFi.mode(WIFI_STA);
+        Serial.printf("ESP-NOW leaf MAC %s\n", WiFi.macAddress().c_str());
+        esp_wifi_set_promiscuous(true);
+        esp_wifi_set_channel(ESPNOW_CHANNEL, WIFI_SECOND_CHAN_NONE);
+        esp_wifi_set_promiscuous(false);
+    }
+
+    if (esp_now_init() != ESP_OK) {
+        Serial.println("ESP-NOW init failed");
+        return false;
+    }
+    esp_now_set_pmk((const uint8_t*)ESPNOW_PMK);
+
+    if (gateway) {
+        // Channel 0 follows the AP's channel
+        int leaves = 0;
+        for (size_t i = 0; i < leafMacCount; i++) {
+            if (isUnsetMac(leafMacs[i])) {
+                continue;
+            }
+            if (!addEncryptedPeer(leafMacs[i], 0)) {
+                Serial.printf("ESP-NOW failed to add leaf peer %u (encrypted peer limit?)\n", (unsigned)i);
+                continue;
+            }
+            leaves++;
+        }
+        if (leaves == 0) {
+            Serial.println("WARNING: ESPNOW_LEAF_MACS is empty, no leaf readings will be relayed");
+        }
+
+        rxQueue = xQueueCreate(ESPNOW_QUEUE_LENGTH, sizeof(RelayFrame));
+        esp_now_register_recv_cb(onEspNowReceive);
+        return rxQueue != nullptr;
+    }
+
+    // Encrypted frames need a unicast peer
+    if (peerMac[0] & 0x01) {
+        Serial.println("ESP-NOW ESPNOW_GATEWAY_MAC is not set");
+        return false;
+    }
+
+    esp_now_register_send_cb(onEspNowSent);
+
+    if (!addEncryptedPeer(peerMac, ESPNOW_CHANNEL)) {
+        Serial.println("ESP-NOW failed to add gateway peer");
+        return false;
+    }
+    return true;
+}
+
+void EspNowLink::end() {
+    esp_now_deinit();
+    if (rxQueue) {
+        vQueueDelete(rxQueue);
+        rxQueue = nullptr;
+    }
+}
+
+bool EspNowLink::send(const uint8_t* data, size_t length) {
+    for (int attempt = 0; attempt < ESPNOW_SEND_RETRIES; attempt++) {
+        sendResult = -1;
+        if (esp_now_send(peerMac, data, length) != ESP_OK) {
+            continue;
+        }
+
+        unsigned long start = millis();
+        while (sendResult < 0 && millis() - start < ESPNOW_SEND_TIMEOUT_MS) {
+            delay(1);
+        }
+        if (sendResult == ESP_NOW_SEND_SUCCESS) {
+            return true;
+        }
+    }
+
+    Serial.printf("ESP-NOW send failed after %d attempts\n", ESPNOW_SEND_RETRIES);
+    return false;
+}
+
+bool EspNowLink::receive(RelayFrame& frame) {
+    return rxQueue && xQueueReceive(rxQueue, &frame, 0) == pdTRUE;
+}
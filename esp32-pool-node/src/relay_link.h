@@ -0,0 +1,49 @@
+#ifndef RELAY_LINK_H
+#define RELAY_LINK_H
+
+#include <Arduino.h>
+#include "relay_packet.h"
+
+// One datagram received from a leaf node
+struct RelayFrame {
+    uint8_t mac[6];
+    uint8_t length;
+    uint8_t data[RELAY_PACKET_MAX_SIZE];
+};
+
+// Connectionless datagram link between leaf nodes and the gateway.
+// Kept minimal (send / poll) so it can be backed by ESP-NOW on the device
+// or by a socket or in-memory queue when simulated on Linux.
+class RelayLink {
+public:
+    virtual ~RelayLink() = default;
+
+    virtual bool begin() = 0;
+    virtual void end() = 0;
+
+    // Blocks until the frame is acknowledged at the MAC layer or times out
+    virtual bool send(const uint8_t* data, size_t length) = 0;
+
+    // Non-blocking; returns false when nothing is queued
+    virtual bool receive(RelayFrame& frame) = 0;
+};
+
+// ESP-NOW implementation.
+// A leaf sends to ESPNOW_GATEWAY_MAC on ESPNOW_CHANNEL without associating
+// with the AP. The gateway listens on its AP's channel; frames arrive in the
+// WiFi task and are queued until receive() is polled from loop().
+class EspNowLink : public RelayLink {
+public:
+    explicit EspNowLink(bool gateway);
+
+    bool begin() override;
+    void end() override;
+    bool send(const uint8_t* data, size_t length) override;
+    bool receive(RelayFrame& frame) override;
+
+private:
+    bool gateway;
+    uint8_t peerMac[6];
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "relay_packet.h"
+#include <string.h>
+
+#define RELAY_FLAG_TEMPERATURE  0x01
+#define RELAY_FLAG_WATER_LEVEL  0x02
+#define RELAY_FLAG_WATER_OK     0x04
+#define RELAY_FLAG_BATTERY      0x08
+
+static void putUint16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void putUint32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint16_t getUint16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+}
+
+static uint32_t getUint32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+// Keeps '/', '+', '#' and control characters out of the relay topic
+static bool isDeviceIdChar(uint8_t c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+           c == '_' || c == '-';
+}
+
+size_t encodeRelayReading(const RelayReading& reading, uint8_t* out, size_t capacity) {
+    size_t idLength = strnlen(reading.deviceId, RELAY_DEVICE_ID_MAX);
+    size_t total = RELAY_PACKET_HEADER_SIZE + idLength;
+    if (total > capacity) {
+        return 0;
+    }
+
+    uint8_t flags = 0;
+    if (reading.hasTemperature) flags |= RELAY_FLAG_TEMPERATURE;
+    if (reading.hasWaterLevel) flags |= RELAY_FLAG_WATER_LEVEL;
+    if (reading.hasWaterLevel && reading.waterLevel) flags |= RELAY_FLAG_WATER_OK;
+    if (reading.hasBattery) flags |= RELAY_FLAG_BATTERY;
+
+    int16_t centiF = 0;
+    if (reading.hasTemperature) {
+        float scaled = reading.temperatureF * 100.0f;
+        centiF = (int16_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+    }
+    uint16_t millivolts = reading.hasBattery ? (uint16_t)(reading.batteryVoltage * 1000.0f + 0.5f) : 0;
+
+    out[0] = RELAY_PACKET_MAGIC;
+    out[1] = RELAY_PACKET_VERSION;
+    out[2] = flags;
+    putUint32(out + 3, reading.sequence);
+    putUint32(out + 7, reading.sequenceEpoch);
+    putUint16(out + 11, reading.radioMs);
+    putUint16(out + 13, (uint16_t)centiF);
+    putUint16(out + 15, millivolts);
+    out[17] = reading.hasBattery ? reading.batteryPercent : 0;
+    out[18] = 0; // Reserved
+    out[19] = idLength;
+    memcpy(out + RELAY_PACKET_HEADER_SIZE, reading.deviceId, idLength);
+
+    return total;
+}
+
+bool decodeRelayReading(const uint8_t* data, size_t length, RelayReading& reading) {
+    if (length < RELAY_PACKET_HEADER_SIZE ||
+        data[0] != RELAY_PACKET_MAGIC || data[1] != RELAY_PACKET_VERSION) {
+        return false;
+    }
+
+    size_t idLength = data[19];
+    if (idLength == 0 || idLength > RELAY_DEVICE_ID_MAX || RELAY_PACKET_HEADER_SIZE + idLength > length) {
+        return false;
+    }
+    for (size_t i = 0; i < idLength; i++) {
+        if (!isDeviceIdChar(data[RELAY_PACKET_HEADER_SIZE + i])) {
+            return false;
+        }
+    }
+
+    uint8_t flags = data[2];
+    reading.sequence = getUint32(data + 3);
+    reading.sequenceEpoch = getUint32(data + 7);
+    reading.radioMs = getUint16(data + 11);
+
+    reading.hasTemperature = flags & RELAY_FLAG_TEMPERATURE;
+    reading.temperatureF = (int16_t)getUint16(data + 13) / 100.0f;
+
+    reading.hasWaterLevel = flags & RELAY_FLAG_WATER_LEVEL;
+    reading.waterLevel = flags & RELAY_FLAG_WATER_OK;
+
+    reading.hasBattery = flags & RELAY_FLAG_BATTERY;
+    reading.batteryVoltage = getUint16(data + 15) / 1000.0f;
+    reading.batteryPercent = data[17];
+
+    memcpy(reading.deviceId, data + RELAY_PACKET_HEADER_SIZE, idLength);
+    reading.deviceId[idLength] = '\0';
+    return true;
+}
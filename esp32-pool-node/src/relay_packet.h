@@ -0,0 +1,42 @@
+#ifndef RELAY_PACKET_H
+#define RELAY_PACKET_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Compact leaf -> gateway reading sent over ESP-NOW.
+// Plain C++ with no Arduino dependencies so the codec also builds on Linux.
+//
+// Wire layout (little-endian):
+//   magic(1) version(1) flags(1) sequence(4) sequence_epoch(4) radio_ms(2)
+//   temperature_centi_f(2) battery_mv(2) battery_pct(1) reserved(1) id_len(1) device_id(id_len)
+// The device ID becomes an MQTT topic level, so it is limited to [A-Za-z0-9_-].
+#define RELAY_PACKET_MAGIC 0x50
+#define RELAY_PACKET_VERSION 2
+#define RELAY_DEVICE_ID_MAX 16
+#define RELAY_PACKET_HEADER_SIZE 20
+#define RELAY_PACKET_MAX_SIZE (RELAY_PACKET_HEADER_SIZE + RELAY_DEVICE_ID_MAX)
+
+struct RelayReading {
+    char deviceId[RELAY_DEVICE_ID_MAX + 1];
+    uint32_t sequence;       // Leaf's takeSequenceNumber()
+    uint32_t sequenceEpoch;  // First sequence number since the leaf's last power-on
+    uint16_t radioMs;        // Leaf radio-on time of the previous cycle
+
+    bool hasTemperature;
+    float temperatureF;      // Sent as hundredths of a degree
+
+    bool hasWaterLevel;
+    bool waterLevel;
+
+    bool hasBattery;
+    float batteryVoltage;    // Sent as millivolts
+    uint8_t batteryPercent;
+};
+
+// Returns the encoded length, or 0 if `capacity` is too small
+size_t encodeRelayReading(const RelayReading& reading, uint8_t* out, size_t capacity);
+// Rejects bad framing and device IDs that are empty or contain other characters
+bool decodeRelayReading(const uint8_t* data, size_t length, RelayReading& reading);
+
+#endif
@@ -0,0 +1,145 @@
+#include "sensor_health.h"
+#include <string.h>
+
+#define SENSOR_HEALTH_ID_MAX 16
+
+struct SensorHealthRecord {
+    char sensorId[SENSOR_HEALTH_ID_MAX];
+    uint8_t state;
+    uint8_t consecutiveFailures;
+    uint16_t backoffS;
+    uint32_t retryAtS;          // Node clock when an open breaker may go half-open
+    uint32_t failures;
+    uint32_t failureMs;         // Time spent on failed probes, inits and reads
+    uint32_t skipped;           // Cycles the sensor was not touched
+};
+
+// HEALTH_CLOSED is 0, so the zeroed records of a cold boot start closed
+RTC_DATA_ATTR static SensorHealthRecord rtcHealth[SENSOR_HEALTH_SLOTS];
+
+// Global instance
+SensorHealth sensorHealth;
+
+// SensorHealth Implementation
+SensorHealthRecord* SensorHealth::find(const String& sensorId, bool create) const {
+    for (int i = 0; i < SENSOR_HEALTH_SLOTS; i++) {
+        SensorHealthRecord& record = rtcHealth[i];
+        if (record.sensorId[0] == '\0') {
+            if (!create) {
+                return nullptr;
+            }
+            strncpy(record.sensorId, sensorId.c_str(), SENSOR_HEALTH_ID_MAX - 1);
+            return &record;
+        }
+        if (strncmp(record.sensorId, sensorId.c_str(), SENSOR_HEALTH_ID_MAX - 1) == 0) {
+            return &record;
+        }
+    }
+    return nullptr;   // Table full: sensor is read every cycle, untracked
+}
+
+bool SensorHealth::allowAttempt(const String& sensorId, uint32_t nowS) {
+    SensorHealthRecord* record = find(sensorId, true);
+    if (!record || record->state != HEALTH_OPEN) {
+        return true;
+    }
+
+    if ((int32_t)(nowS - record->retryAtS) >= 0) {
+        record->state = HEALTH_HALF_OPEN;
+        Serial.printf("Sensor %s: backoff expired, re-probing\n", sensorId.c_str());
+        return true;
+    }
+
+    record->skipped++;
+    return false;
+}
+
+void SensorHealth::recordSuccess(const String& sensorId) {
+    SensorHealthRecord* record = find(sensorId, true);
+    if (!record) {
+        return;
+    }
+    if (record->state != HEALTH_CLOSED) {
+        Serial.printf("Sensor %s recovered after %lu failures\n", sensorId.c_str(), (unsigned long)record->failures);
+    }
+    record->state = HEALTH_CLOSED;
+    record->consecutiveFailures = 0;
+    record->backoffS = 0;
+}
+
+void SensorHealth::recordFailure(const String& sensorId, unsigned long costMs, uint32_t nowS, bool unavailable) {
+    SensorHealthRecord* record = find(sensorId, true);
+    if (!record) {
+        return;
+    }
+    record->failures++;
+    record->failureMs += costMs;
+    if (record->consecutiveFailures < 0xFF) {
+        record->consecutiveFailures++;
+    }
+
+    bool trip = record->state == HEALTH_HALF_OPEN || unavailable ||
+                record->consecutiveFailures >= failureThreshold;
+    if (!trip) {
+        return;
+    }
+
+    // Exponential backoff: each failed re-probe doubles the wait
+    if (record->backoffS == 0) {
+        record->backoffS = backoffInitialS;
+    } else if (record->state == HEALTH_HALF_OPEN) {
+        record->backoffS = record->backoffS >= backoffMaxS / 2 ? backoffMaxS : record->backoffS * 2;
+    }
+    record->state = HEALTH_OPEN;
+    record->retryAtS = nowS + record->backoffS;
+
+    Serial.printf("Sensor %s: circuit open, next probe in %u s (%lu ms lost to failures)\n",
+                 sensorId.c_str(), record->backoffS, (unsigned long)record->failureMs);
+}
+
+void SensorHealth::setPolicy(uint8_t failureThreshold, uint16_t backoffInitialS, uint16_t backoffMaxS) {
+    this->failureThreshold = failureThreshold;
+    this->backoffInitialS = backoffInitialS;
+    this->backoffMaxS = backoffMaxS;
+}
+
+HealthState SensorHealth::getState(const String& sensorId) const {
+    SensorHealthRecord* record = find(sensorId, false);
+    return record ? (HealthState)record->state : HEALTH_CLOSED;
+}
+
+bool SensorHealth::isDegraded(const String& sensorId) const {
+    SensorHealthRecord* record = find(sensorId, false);
+    return record && (record->state != HEALTH_CLOSED || record->consecutiveFailures > 0);
+}
+
+unsigned long SensorHealth::getFailureCount(const String& sensorId) const {
+    SensorHealthRecord* record = find(sensorId, false);
+    return record ? record->failures : 0;
+}
+
+void SensorHealth::report(JsonObject out, uint32_t nowS) const {
+    for (int i = 0; i < SENSOR_HEALTH_SLOTS && rtcHealth[i].sensorId[0] != '\0'; i++) {
+        const SensorHealthRecord& record = rtcHealth[i];
+        JsonObject entry = out[record.sensorId].to<JsonObject>();
+        entry["state"] = getStateName((HealthState)record.state);
+        entry["failures"] = record.failures;
+        entry["failure_ms"] = record.failureMs;
+        if (record.skipped > 0) {
+            entry["skipped"] = record.skipped;
+        }
+        if (record.state == HEALTH_OPEN) {
+            int32_t retryIn = (int32_t)(record.retryAtS - nowS);
+            entry["retry_in_s"] = retryIn > 0 ? retryIn : 0;
+        }
+    }
+}
+
+const char* SensorHealth::getStateName(HealthState state) {
+    switch (state) {
+        case HEALTH_CLOSED: return "closed";
+        case HEALTH_OPEN: return "open";
+        case HEALTH_HALF_OPEN: return "half_open";
+        default: return "unknown";
+    }
+}
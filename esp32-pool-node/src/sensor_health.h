@@ -0,0 +1,54 @@
+#ifndef SENSOR_HEALTH_H
+#define SENSOR_HEALTH_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+struct SensorHealthRecord;
+
+enum HealthState {
+    HEALTH_CLOSED = 0,   // Normal: read every cycle
+    HEALTH_OPEN,         // Failing: skipped until the backoff expires
+    HEALTH_HALF_OPEN     // One cheap re-probe / single-attempt read decides
+};
+
+// Per-sensor circuit breaker.
+// A sensor that fails SENSOR_FAILURE_THRESHOLD reads in a row, or cannot be
+// initialized, is opened and skipped. Once its backoff expires it goes
+// half-open and gets one cheap probe (presence pulse, single I2C address) and
+// one single-attempt read; success closes it, failure reopens it with double
+// the backoff, up to SENSOR_BACKOFF_MAX_S. State and failure time live in RTC
+// memory, so a dead sensor costs nothing across deep-sleep wakes either.
+class SensorHealth {
+public:
+    // True if the sensor should be touched this cycle; moves an expired open breaker to half-open
+    bool allowAttempt(const String& sensorId, uint32_t nowS);
+
+    void recordSuccess(const String& sensorId);
+    // `unavailable` (probe or initialize failed) opens the breaker at once
+    void recordFailure(const String& sensorId, unsigned long costMs, uint32_t nowS, bool unavailable);
+
+    HealthState getState(const String& sensorId) const;
+    // Half-open or already failing: sensors make a single attempt instead of retrying
+    bool isDegraded(const String& sensorId) const;
+    unsigned long getFailureCount(const String& sensorId) const;
+
+    // Remote configuration; defaults are the SENSOR_* values in config.h
+    void setPolicy(uint8_t failureThreshold, uint16_t backoffInitialS, uint16_t backoffMaxS);
+
+    // {"<sensor_id>": {"state", "failures", "failure_ms", "skipped", "retry_in_s"}}
+    void report(JsonObject out, uint32_t nowS) const;
+    static const char* getStateName(HealthState state);
+
+private:
+    uint8_t failureThreshold = SENSOR_FAILURE_THRESHOLD;
+    uint16_t backoffInitialS = SENSOR_BACKOFF_INITIAL_S;
+    uint16_t backoffMaxS = SENSOR_BACKOFF_MAX_S;
+
+    SensorHealthRecord* find(const String& sensorId, bool create) const;
+};
+
+extern SensorHealth sensorHealth;
+
+#endif
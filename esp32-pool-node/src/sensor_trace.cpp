@@ -0,0 +1,67 @@
+#include "sensor_trace.h"
+
+#if TRACE_SINK == TRACE_SINK_MQTT
+// Chunks are published whole; leave room for the topic and MQTT header
+static_assert(TRACE_BUFFER_SIZE + 64 <= MQTT_BUFFER_SIZE, "TRACE_BUFFER_SIZE must fit in MQTT_BUFFER_SIZE");
+#endif
+
+// Global instance
+SensorTrace sensorTrace;
+
+// SensorTrace Implementation
+SensorTrace::SensorTrace()
+    : enabled(TRACE_SINK != TRACE_SINK_NONE), started(false), hasRecords(false) {
+}
+
+void SensorTrace::startCycle(uint32_t nodeClockS) {
+    if (!enabled) {
+        return;
+    }
+
+    writer.begin(buffer, sizeof(buffer), DEVICE_ID, millis(), nodeClockS);
+    // Every chunk starts with unknown pin levels so it can be replayed on its own
+    memset(lastLevel, -1, sizeof(lastLevel));
+    started = true;
+    hasRecords = false;
+}
+
+void SensorTrace::beginOperation(TraceOperation op, const String& sensorId) {
+    if (started) {
+        hasRecords = writer.beginOperation(millis(), op, sensorId.c_str()) || hasRecords;
+    }
+}
+
+void SensorTrace::endOperation() {
+    if (started) {
+        writer.endOperation(millis());
+    }
+}
+
+int SensorTrace::readDigital(int pin) {
+    int level = digitalRead(pin);
+
+    if (started && pin >= 0 && pin < TRACE_MAX_PINS && lastLevel[pin] != level) {
+        lastLevel[pin] = level;
+        writer.digital(millis(), pin, level);
+    }
+    return level;
+}
+
+void SensorTrace::value(TraceChannel channel, float value) {
+    if (started) {
+        writer.value(millis(), channel, value);
+    }
+}
+
+size_t SensorTrace::finish() {
+    if (!started) {
+        return 0;
+    }
+    started = false;
+
+    size_t length = writer.finish();
+    if (writer.isTruncated()) {
+        Serial.printf("Sensor trace truncated at %u bytes\n", (unsigned)length);
+    }
+    return hasRecords ? length : 0;
+}
@@ -0,0 +1,49 @@
+#ifndef SENSOR_TRACE_H
+#define SENSOR_TRACE_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "trace_format.h"
+
+// Records raw sensor I/O (pin levels, driver readings) and timing for one
+// wake cycle into a trace chunk (trace_format.h). main.cpp ships the chunk
+// to the configured sink; replay/sensor_replay.cpp feeds it back into the
+// sensor classes on Linux. With TRACE_SINK_NONE every call is a no-op
+// apart from the pin read itself.
+class SensorTrace {
+public:
+    SensorTrace();
+
+    // Starts a new chunk; anything not yet taken with finish() is discarded
+    void startCycle(uint32_t nodeClockS);
+    void beginOperation(TraceOperation op, const String& sensorId);
+    void endOperation();
+
+    // digitalRead() that records level changes
+    int readDigital(int pin);
+    void value(TraceChannel channel, float value);
+
+    // Finalizes the chunk; returns its size (0 when disabled or empty)
+    size_t finish();
+    const uint8_t* getData() const { return buffer; }
+    bool isEnabled() const { return enabled; }
+
+private:
+    TraceWriter writer;
+    uint8_t buffer[TRACE_BUFFER_SIZE];
+    int8_t lastLevel[TRACE_MAX_PINS];
+    bool enabled;
+    bool started;
+    bool hasRecords;
+};
+
+extern SensorTrace sensorTrace;
+
+// Marks one initialize()/readData() call for the lifetime of the scope
+class TraceScope {
+public:
+    TraceScope(TraceOperation op, const String& sensorId) { sensorTrace.beginOperation(op, sensorId); }
+    ~TraceScope() { sensorTrace.endOperation(); }
+};
+
+#endif
@@ -1,5 +1,9 @@
 #include "sensors.h"
 #include "config.h"
+#include "json_arena.h"
+#include "cycle_budget.h"
+#include "sensor_trace.h"
+#include "sensor_health.h"
 #include <OneWire.h>
 #include <DallasTemperature.h>
 #include <Adafruit_MAX1704X.h>
@@ -7,15 +11,20 @@
 
 // TemperatureSensor Implementation
 TemperatureSensor::TemperatureSensor(const String& id, int pin) 
-    : sensorPin(pin), lastReading(-999.0) {
+    : sensorPin(pin), lastReading(-999.0), readRetries(SENSOR_READ_RETRIES) {
     sensorId = id;
     oneWire = nullptr;
     tempSensor = nullptr;
 }
 
 bool TemperatureSensor::initialize() {
-    oneWire = new OneWire(sensorPin);
-    tempSensor = new DallasTemperature((OneWire*)oneWire);
+    TraceScope trace(TRACE_OP_INIT, sensorId);
+    
+    // Re-initialization after a failure reuses the bus objects
+    if (!oneWire) {
+        oneWire = new OneWire(sensorPin);
+        tempSensor = new DallasTemperature((OneWire*)oneWire);
+    }
     
     ((DallasTemperature*)tempSensor)->begin();
     ((DallasTemperature*)tempSensor)->setResolution(TEMPERATURE_PRECISION);
@@ -25,6 +34,7 @@ bool TemperatureSensor::initialize() {
     delay(1000);
     
     float testTemp = ((DallasTemperature*)tempSensor)->getTempFByIndex(0);
+    sensorTrace.value(TRACE_TEMPERATURE_F, testTemp);
     initialized = validateTemperature(testTemp);
     
     Serial.printf("Temperature sensor %s initialized: %s\n", 
@@ -34,15 +44,21 @@ bool TemperatureSensor::initialize() {
 }
 
 JsonDocument TemperatureSensor::readData() {
-    JsonDocument doc;
+    TraceScope trace(TRACE_OP_READ, sensorId);
+    JsonDocument doc(&jsonArena);
     
     if (!initialized) {
         doc["error"] = "Sensor not initialized";
         return doc;
     }
     
-    float temperature = readTemperatureWithRetry();
-    
+    // A sensor that is already failing gets one attempt instead of 3 x 1.75 s
+    float temperature = readTemperatureWithRetry(sensorHealth.isDegraded(sensorId) ? 1 : readRetries);
+    buildReading(doc, temperature);
+    return doc;
+}
+
+void TemperatureSensor::buildReading(JsonDocument& doc, float temperature) {
     doc["sensor_id"] = sensorId;
     doc["sensor_type"] = getType();
     doc["timestamp"] = millis();
@@ -57,20 +73,31 @@ JsonDocument TemperatureSensor::readData() {
         doc["quality"] = "questionable";
         doc["error"] = "Invalid reading, using last known value";
     }
-    
-    return doc;
 }
 
 bool TemperatureSensor::isAvailable() const {
     return initialized && tempSensor != nullptr;
 }
 
+bool TemperatureSensor::probe() {
+    // 1-Wire reset: any device on the bus answers with a presence pulse (~1 ms)
+    OneWire bus(sensorPin);
+    return bus.reset() == 1;
+}
+
 float TemperatureSensor::readTemperatureWithRetry(int retries) {
     for (int i = 0; i < retries; i++) {
+        // Give up on further retries once the acquire budget is spent
+        if (i > 0 && cycleBudget.expired()) {
+            Serial.printf("Temperature retries stopped by cycle budget after %d attempts\n", i);
+            break;
+        }
+        
         ((DallasTemperature*)tempSensor)->requestTemperatures();
         delay(750); // Wait for conversion
         
         float temp = ((DallasTemperature*)tempSensor)->getTempFByIndex(0);
+        sensorTrace.value(TRACE_TEMPERATURE_F, temp);
         
         if (validateTemperature(temp)) {
             return temp;
@@ -89,17 +116,18 @@ bool TemperatureSensor::validateTemperature(float temp) {
 
 // WaterLevelSensor Implementation
 WaterLevelSensor::WaterLevelSensor(const String& id, int pin1, int pin2) 
-    : switchPin1(pin1), switchPin2(pin2), lastLevel(false) {
+    : switchPin1(pin1), switchPin2(pin2), lastLevel(false), lastSampleCount(0), sampleCount(FLOAT_SWITCH_SAMPLES) {
     sensorId = id;
 }
 
 bool WaterLevelSensor::initialize() {
+    TraceScope trace(TRACE_OP_INIT, sensorId);
     pinMode(switchPin1, INPUT_PULLUP);
     pinMode(switchPin2, INPUT_PULLUP);
     
     // Test pins are responsive
-    int test1 = digitalRead(switchPin1);
-    int test2 = digitalRead(switchPin2);
+    int test1 = sensorTrace.readDigital(switchPin1);
+    int test2 = sensorTrace.readDigital(switchPin2);
     
     initialized = true; // Float switches are simple digital inputs
     
@@ -110,7 +138,8 @@ bool WaterLevelSensor::initialize() {
 }
 
 JsonDocument WaterLevelSensor::readData() {
-    JsonDocument doc;
+    TraceScope trace(TRACE_OP_READ, sensorId);
+    JsonDocument doc(&jsonArena);
     
     doc["sensor_id"] = sensorId;
     doc["sensor_type"] = getType();
@@ -122,12 +151,13 @@ JsonDocument WaterLevelSensor::readData() {
         return doc;
     }
     
-    bool level = readFloatSwitchAverage();
+    bool level = readFloatSwitchAverage(sampleCount);
     
     doc["value"] = level;
     doc["quality"] = "good";
-    doc["raw_pin1"] = digitalRead(switchPin1);
-    doc["raw_pin2"] = digitalRead(switchPin2);
+    doc["samples"] = lastSampleCount;
+    doc["raw_pin1"] = sensorTrace.readDigital(switchPin1);
+    doc["raw_pin2"] = sensorTrace.readDigital(switchPin2);
     
     lastLevel = level;
     
@@ -143,9 +173,16 @@ bool WaterLevelSensor::readFloatSwitchAverage(int samples) {
     int accumulator = 0;
     
     for (int i = 0; i < samples; i++) {
+        // Debounce over a shorter window if the acquire budget runs out
+        if (i > 0 && cycleBudget.expired()) {
+            Serial.printf("Float switch debounce cut short at %d/%d samples\n", i, samples);
+            samples = i;
+            break;
+        }
+        
         // Logic: if either pin is LOW, water level is adequate  
-        bool pin1State = digitalRead(switchPin1) == LOW;
-        bool pin2State = digitalRead(switchPin2) == LOW;
+        bool pin1State = sensorTrace.readDigital(switchPin1) == LOW;
+        bool pin2State = sensorTrace.readDigital(switchPin2) == LOW;
         bool waterOK = pin1State || pin2State;
         
         accumulator += waterOK ? 1 : 0;
@@ -164,6 +201,8 @@ bool WaterLevelSensor::readFloatSwitchAverage(int samples) {
         delay(100); // 100ms delay between readings for 10+ second total
     }
     
+    lastSampleCount = samples;
+    
     // Return true ONLY if ALL readings are consistent (like Python version)
     // If accumulator == samples, all readings were consistent
     return (accumulator == samples);
@@ -171,24 +210,31 @@ bool WaterLevelSensor::readFloatSwitchAverage(int samples) {
 
 // BatterySensor Implementation
 BatterySensor::BatterySensor(const String& id, int pin) 
-    : adcPin(pin), lastVoltage(0.0), lastPercentage(0) {
+    : adcPin(pin), lastVoltage(0.0), lastPercentage(0),
+      lowThresholdV(LOW_BATTERY_THRESHOLD), criticalThresholdV(CRITICAL_BATTERY_THRESHOLD) {
     sensorId = id;
 }
 
 bool BatterySensor::initialize() {
+    TraceScope trace(TRACE_OP_INIT, sensorId);
+    
     // Initialize I2C for ESP32-S3 Feather (SDA=3, SCL=4)
     Wire.begin(3, 4);
     
     // Initialize MAX17048 battery monitor
-    if (!maxlipo.begin()) {
+    bool found = maxlipo.begin();
+    sensorTrace.value(TRACE_BATTERY_PRESENT, found ? 1.0f : 0.0f);
+    if (!found) {
         Serial.printf("Battery sensor %s: Could not find MAX17048! Check battery connection.\n", sensorId.c_str());
-        Serial.println("Trying I2C scan...");
         
-        // I2C scanner to debug
-        for (byte address = 1; address < 127; address++) {
-            Wire.beginTransmission(address);
-            if (Wire.endTransmission() == 0) {
-                Serial.printf("I2C device found at address 0x%02X\n", address);
+        // Full bus scan only on the first failure since power-on; re-probes use probe()
+        if (sensorHealth.getFailureCount(sensorId) == 0) {
+            Serial.println("Trying I2C scan...");
+            for (byte address = 1; address < 127; address++) {
+                Wire.beginTransmission(address);
+                if (Wire.endTransmission() == 0) {
+                    Serial.printf("I2C device found at address 0x%02X\n", address);
+                }
             }
         }
         
@@ -204,7 +250,8 @@ bool BatterySensor::initialize() {
 }
 
 JsonDocument BatterySensor::readData() {
-    JsonDocument doc;
+    TraceScope trace(TRACE_OP_READ, sensorId);
+    JsonDocument doc(&jsonArena);
     
     doc["sensor_id"] = sensorId;
     doc["sensor_type"] = getType();
@@ -221,12 +268,19 @@ JsonDocument BatterySensor::readData() {
     
     doc["value"] = voltage;
     doc["percentage"] = percentage;
+    
+    // readBatteryVoltage() returns 0 when the gauge stops answering
+    if (voltage <= 0.0) {
+        doc["quality"] = "questionable";
+        doc["error"] = "Battery monitor not responding";
+        return doc;
+    }
     doc["quality"] = "good";
     
     // Add battery status
-    if (voltage < CRITICAL_BATTERY_THRESHOLD) {
+    if (voltage < criticalThresholdV) {
         doc["status"] = "critical";
-    } else if (voltage < LOW_BATTERY_THRESHOLD) {
+    } else if (voltage < lowThresholdV) {
         doc["status"] = "low";
     } else {
         doc["status"] = "good";
@@ -242,9 +296,17 @@ bool BatterySensor::isAvailable() const {
     return initialized;
 }
 
+bool BatterySensor::probe() {
+    // Address the MAX17048 alone instead of scanning the bus
+    Wire.begin(3, 4);
+    Wire.beginTransmission(MAX17048_I2C_ADDRESS);
+    return Wire.endTransmission() == 0;
+}
+
 float BatterySensor::readBatteryVoltage() {
     // Read battery voltage using MAX17048
     float cellVoltage = maxlipo.cellVoltage();
+    sensorTrace.value(TRACE_BATTERY_VOLTAGE, cellVoltage);
     
     if (isnan(cellVoltage)) {
         Serial.println("Failed to read cell voltage, check battery is connected!");
@@ -257,6 +319,7 @@ float BatterySensor::readBatteryVoltage() {
 int BatterySensor::calculatePercentage(float voltage) {
     // Use MAX17048's built-in battery percentage calculation
     float cellPercent = maxlipo.cellPercent();
+    sensorTrace.value(TRACE_BATTERY_PERCENT, cellPercent);
     
     if (isnan(cellPercent)) {
         Serial.println("Failed to read cell percentage!");
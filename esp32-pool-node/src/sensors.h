@@ -17,6 +17,9 @@ public:
     virtual JsonDocument readData() = 0;
     virtual bool isAvailable() const = 0;
     
+    // Cheap presence check before a failed sensor is re-initialized
+    virtual bool probe() { return true; }
+    
 protected:
     String sensorId;
     bool initialized = false;
@@ -33,12 +36,19 @@ public:
     String getUnits() const override { return "fahrenheit"; }
     JsonDocument readData() override;
     bool isAvailable() const override;
+    bool probe() override;
+    
+    void setRetries(int retries) { readRetries = retries; }
+    
+    // readData() without the bus I/O: fills the document from a converted reading
+    void buildReading(JsonDocument& doc, float temperature);
     
 private:
     int sensorPin;
     void* oneWire;      // OneWire instance
     void* tempSensor;   // DallasTemperature instance
     float lastReading;
+    int readRetries;
     
     float readTemperatureWithRetry(int retries = 3);
     bool validateTemperature(float temp);
@@ -56,10 +66,14 @@ public:
     JsonDocument readData() override;
     bool isAvailable() const override;
     
+    void setSampleCount(int samples) { sampleCount = samples; }
+    
 private:
     int switchPin1;
     int switchPin2;
     bool lastLevel;
+    int lastSampleCount;
+    int sampleCount;
     
     bool readFloatSwitchAverage(int samples = 10);
 };
@@ -75,11 +89,16 @@ public:
     String getUnits() const override { return "volts"; }
     JsonDocument readData() override;
     bool isAvailable() const override;
+    bool probe() override;
+    
+    void setThresholds(float lowV, float criticalV) { lowThresholdV = lowV; criticalThresholdV = criticalV; }
     
 private:
     int adcPin;
     float lastVoltage;
     int lastPercentage;
+    float lowThresholdV;
+    float criticalThresholdV;
     Adafruit_MAX17048 maxlipo;
     
     float readBatteryVoltage();
@@ -0,0 +1,424 @@
+#include "series_codec.h"
+#include <math.h>
+#include <string.h>
+
+// Quantization steps for SERIES_QUANTIZED, matching BufferedReading
+static const float QUANTIZE_SCALE[SERIES_CHANNEL_COUNT] = {100.0f, 1000.0f, 1.0f};
+
+static bool channelPresent(int channel, uint8_t flags) {
+    return channel == SERIES_TEMPERATURE_F ? (flags & SERIES_HAS_TEMPERATURE) != 0
+                                           : (flags & SERIES_HAS_BATTERY) != 0;
+}
+
+static uint32_t floatBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bitsFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static uint32_t lowMask(int bits) {
+    return bits >= 32 ? 0xFFFFFFFFu : (1u << bits) - 1;
+}
+
+static int leadingZeros(uint32_t x) {
+    return __builtin_clz(x);
+}
+
+static int trailingZeros(uint32_t x) {
+    return __builtin_ctz(x);
+}
+
+static void putUint16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void putUint32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint16_t getUint16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+}
+
+static uint32_t getUint32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+// SeriesEncoder Implementation
+void SeriesEncoder::begin(uint8_t* buffer, size_t capacity, uint8_t encoding) {
+    this->buffer = buffer;
+    this->capacity = capacity > 0xFFFF ? 0xFFFF : capacity;
+    this->encoding = encoding;
+    count = 0;
+    memset(&state, 0, sizeof(state));
+}
+
+size_t SeriesEncoder::getLength() const {
+    return SERIES_HEADER_SIZE + bitBytes() + SERIES_RUN_SIZE * (state.runCount + (count > 0 ? 1 : 0));
+}
+
+bool SeriesEncoder::append(const SeriesSample& sample) {
+    if (count == 0xFFFF) {
+        return false;
+    }
+
+    State saved = state;
+    bool ok = true;
+
+    // Flags: extend the open run or close it into the tail of the buffer
+    if (count == 0) {
+        state.runFlags = sample.flags;
+        state.runLength = 1;
+    } else if (sample.flags == state.runFlags && state.runLength < 0xFFFF) {
+        state.runLength++;
+    } else {
+        ok = writeRun();
+        state.runFlags = sample.flags;
+        state.runLength = 1;
+    }
+
+    // Timestamp: raw for the first sample, then delta-of-delta
+    if (ok && count == 0) {
+        ok = writeBits(sample.timestampS, 32);
+        state.lastDelta = 0;
+    } else if (ok) {
+        int32_t delta = (int32_t)(sample.timestampS - state.lastTimestamp);
+        ok = writeInteger(delta - state.lastDelta);
+        state.lastDelta = delta;
+    }
+    state.lastTimestamp = sample.timestampS;
+
+    // Sequence: raw for the first sample, then the step less one (0 while consecutive)
+    if (ok && count == 0) {
+        ok = writeBits(sample.sequence, 32);
+    } else if (ok) {
+        ok = writeInteger((int32_t)(sample.sequence - state.lastSequence - 1));
+    }
+    state.lastSequence = sample.sequence;
+
+    for (int channel = 0; ok && channel < SERIES_CHANNEL_COUNT; channel++) {
+        if (!channelPresent(channel, sample.flags)) {
+            continue;
+        }
+        if (encoding == SERIES_XOR) {
+            ok = writeXor(channel, floatBits(sample.values[channel]));
+        } else {
+            int32_t quantized = (int32_t)lroundf(sample.values[channel] * QUANTIZE_SCALE[channel]);
+            ok = writeInteger((int32_t)((uint32_t)quantized - state.lastBits[channel]));
+            state.lastBits[channel] = (uint32_t)quantized;
+        }
+    }
+
+    if (!ok) {
+        state = saved;
+        return false;
+    }
+    count++;
+    return true;
+}
+
+size_t SeriesEncoder::finish(uint32_t nowS) {
+    if (capacity < SERIES_HEADER_SIZE) {
+        return 0;
+    }
+    if (count > 0) {
+        // Space for the open run was reserved by every append
+        writeRun();
+    }
+
+    // Runs were stored backwards from the end; put them in order behind the bitstream
+    size_t runBytes = SERIES_RUN_SIZE * state.runCount;
+    uint8_t* runs = buffer + capacity - runBytes;
+    for (uint16_t i = 0; i < state.runCount / 2; i++) {
+        uint8_t* a = runs + SERIES_RUN_SIZE * i;
+        uint8_t* b = runs + SERIES_RUN_SIZE * (state.runCount - 1 - i);
+        uint8_t swap[SERIES_RUN_SIZE];
+        memcpy(swap, a, SERIES_RUN_SIZE);
+        memcpy(a, b, SERIES_RUN_SIZE);
+        memcpy(b, swap, SERIES_RUN_SIZE);
+    }
+
+    size_t bitsLength = bitBytes();
+    if (state.bitPosition % 8) {
+        buffer[SERIES_HEADER_SIZE + bitsLength - 1] &= ~lowMask(8 - state.bitPosition % 8);
+    }
+    memmove(buffer + SERIES_HEADER_SIZE + bitsLength, runs, runBytes);
+
+    buffer[0] = SERIES_MAGIC_0;
+    buffer[1] = SERIES_MAGIC_1;
+    buffer[2] = SERIES_VERSION;
+    buffer[3] = encoding;
+    putUint16(&buffer[4], count);
+    putUint16(&buffer[6], bitsLength);
+    putUint16(&buffer[8], state.runCount);
+    putUint32(&buffer[10], nowS);
+    return SERIES_HEADER_SIZE + bitsLength + runBytes;
+}
+
+bool SeriesEncoder::writeBits(uint32_t value, int bits) {
+    // The open run always keeps a reserved slot at the tail
+    size_t needed = SERIES_HEADER_SIZE + (state.bitPosition + bits + 7) / 8 +
+                    SERIES_RUN_SIZE * (state.runCount + 1);
+    if (needed > capacity) {
+        return false;
+    }
+
+    // MSB first; bits past the write position may be left over from a rolled-back append
+    while (bits > 0) {
+        uint8_t& byte = buffer[SERIES_HEADER_SIZE + state.bitPosition / 8];
+        int free = 8 - state.bitPosition % 8;
+        int n = bits < free ? bits : free;
+        uint8_t chunk = (value >> (bits - n)) & lowMask(n);
+        uint8_t mask = lowMask(n) << (free - n);
+        byte = (byte & ~mask) | (chunk << (free - n));
+        state.bitPosition += n;
+        bits -= n;
+    }
+    return true;
+}
+
+bool SeriesEncoder::writeInteger(int32_t value) {
+    uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    if (zigzag == 0) {
+        return writeBits(0x0, 1);
+    }
+    if (zigzag < (1u << 7)) {
+        return writeBits((0x2u << 7) | zigzag, 9);
+    }
+    if (zigzag < (1u << 9)) {
+        return writeBits((0x6u << 9) | zigzag, 12);
+    }
+    if (zigzag < (1u << 12)) {
+        return writeBits((0xEu << 12) | zigzag, 16);
+    }
+    return writeBits(0xF, 4) && writeBits(zigzag, 32);
+}
+
+bool SeriesEncoder::writeXor(int channel, uint32_t bits) {
+    uint32_t x = bits ^ state.lastBits[channel];
+    state.lastBits[channel] = bits;
+    if (x == 0) {
+        return writeBits(0x0, 1);
+    }
+
+    int leading = leadingZeros(x);
+    int trailing = trailingZeros(x);
+
+    // Reuse the previous window when the changed bits fall inside it
+    int windowLeading = state.leading[channel];
+    int windowLength = state.meaningful[channel];
+    if (windowLength > 0 && leading >= windowLeading && trailing >= 32 - windowLeading - windowLength) {
+        return writeBits(0x2, 2) &&
+               writeBits(x >> (32 - windowLeading - windowLength), windowLength);
+    }
+
+    int length = 32 - leading - trailing;
+    state.leading[channel] = leading;
+    state.meaningful[channel] = length;
+    return writeBits((0x3u << 10) | (leading << 5) | (length - 1), 12) &&
+           writeBits(x >> trailing, length);
+}
+
+bool SeriesEncoder::writeRun() {
+    if (SERIES_HEADER_SIZE + bitBytes() + SERIES_RUN_SIZE * (state.runCount + 1) > capacity) {
+        return false;
+    }
+    uint8_t* run = buffer + capacity - SERIES_RUN_SIZE * (state.runCount + 1);
+    run[0] = state.runFlags;
+    putUint16(&run[1], state.runLength);
+    state.runCount++;
+    return true;
+}
+
+// SeriesDecoder Implementation
+SeriesDecoder::SeriesDecoder(const uint8_t* data, size_t length)
+    : data(data), length(length), encoding(SERIES_QUANTIZED), remaining(0), bitPosition(0), bitEnd(0),
+      runs(nullptr), runsLeft(0), runFlags(0), runLeft(0), lastTimestamp(0), lastDelta(0), lastSequence(0), first(true) {
+    memset(lastBits, 0, sizeof(lastBits));
+    memset(leading, 0, sizeof(leading));
+    memset(meaningful, 0, sizeof(meaningful));
+}
+
+bool SeriesDecoder::begin(SeriesBlockInfo& info) {
+    if (length < SERIES_HEADER_SIZE || data[0] != SERIES_MAGIC_0 || data[1] != SERIES_MAGIC_1 ||
+        data[2] != SERIES_VERSION || data[3] > SERIES_XOR) {
+        return false;
+    }
+
+    uint16_t bitsLength = getUint16(&data[6]);
+    uint16_t runCount = getUint16(&data[8]);
+    if (SERIES_HEADER_SIZE + bitsLength + (size_t)SERIES_RUN_SIZE * runCount > length) {
+        return false;
+    }
+
+    encoding = data[3];
+    remaining = getUint16(&data[4]);
+    bitPosition = 0;
+    bitEnd = (size_t)bitsLength * 8;
+    runs = data + SERIES_HEADER_SIZE + bitsLength;
+    runsLeft = runCount;
+    runLeft = 0;
+    first = true;
+
+    info.encoding = encoding;
+    info.count = remaining;
+    info.nowS = getUint32(&data[10]);
+    info.blockLength = SERIES_HEADER_SIZE + bitsLength + (size_t)SERIES_RUN_SIZE * runCount;
+    return true;
+}
+
+bool SeriesDecoder::next(SeriesSample& sample) {
+    if (remaining == 0) {
+        return false;
+    }
+
+    if (runLeft == 0) {
+        if (runsLeft == 0) {
+            return false;
+        }
+        runFlags = runs[0];
+        runLeft = getUint16(&runs[1]);
+        runs += SERIES_RUN_SIZE;
+        runsLeft--;
+        if (runLeft == 0) {
+            return false;
+        }
+    }
+
+    memset(&sample, 0, sizeof(sample));
+    sample.flags = runFlags;
+
+    if (first) {
+        if (!readBits(32, lastTimestamp)) {
+            return false;
+        }
+        lastDelta = 0;
+        if (!readBits(32, lastSequence)) {
+            return false;
+        }
+        first = false;
+    } else {
+        int32_t deltaOfDelta;
+        if (!readInteger(deltaOfDelta)) {
+            return false;
+        }
+        lastDelta += deltaOfDelta;
+        lastTimestamp += lastDelta;
+
+        int32_t step;
+        if (!readInteger(step)) {
+            return false;
+        }
+        lastSequence += (uint32_t)step + 1;
+    }
+    sample.timestampS = lastTimestamp;
+    sample.sequence = lastSequence;
+
+    for (int channel = 0; channel < SERIES_CHANNEL_COUNT; channel++) {
+        if (!channelPresent(channel, sample.flags)) {
+            continue;
+        }
+        if (encoding == SERIES_XOR) {
+            uint32_t bits;
+            if (!readXor(channel, bits)) {
+                return false;
+            }
+            sample.values[channel] = bitsFloat(bits);
+        } else {
+            int32_t delta;
+            if (!readInteger(delta)) {
+                return false;
+            }
+            lastBits[channel] += (uint32_t)delta;
+            sample.values[channel] = (int32_t)lastBits[channel] / QUANTIZE_SCALE[channel];
+        }
+    }
+
+    runLeft--;
+    remaining--;
+    return true;
+}
+
+bool SeriesDecoder::readBits(int bits, uint32_t& value) {
+    if (bitPosition + bits > bitEnd) {
+        return false;
+    }
+    const uint8_t* stream = data + SERIES_HEADER_SIZE;
+    value = 0;
+    while (bits > 0) {
+        int free = 8 - bitPosition % 8;
+        int n = bits < free ? bits : free;
+        uint32_t chunk = (stream[bitPosition / 8] >> (free - n)) & lowMask(n);
+        value = (value << n) | chunk;
+        bitPosition += n;
+        bits -= n;
+    }
+    return true;
+}
+
+bool SeriesDecoder::readInteger(int32_t& value) {
+    static const int PAYLOAD_BITS[] = {0, 7, 9, 12, 32};
+    int prefix = 0;
+    uint32_t bit;
+    while (prefix < 4) {
+        if (!readBits(1, bit)) {
+            return false;
+        }
+        if (!bit) {
+            break;
+        }
+        prefix++;
+    }
+
+    uint32_t zigzag = 0;
+    if (prefix > 0 && !readBits(PAYLOAD_BITS[prefix], zigzag)) {
+        return false;
+    }
+    value = (int32_t)((zigzag >> 1) ^ (0u - (zigzag & 1)));
+    return true;
+}
+
+bool SeriesDecoder::readXor(int channel, uint32_t& bits) {
+    uint32_t control;
+    if (!readBits(1, control)) {
+        return false;
+    }
+    if (!control) {
+        bits = lastBits[channel];
+        return true;
+    }
+
+    if (!readBits(1, control)) {
+        return false;
+    }
+    if (control) {
+        uint32_t header;
+        if (!readBits(10, header)) {
+            return false;
+        }
+        leading[channel] = header >> 5;
+        meaningful[channel] = (header & 0x1F) + 1;
+        if (leading[channel] + meaningful[channel] > 32) {
+            return false;
+        }
+    } else if (meaningful[channel] == 0) {
+        return false;
+    }
+
+    uint32_t value;
+    if (!readBits(meaningful[channel], value)) {
+        return false;
+    }
+    lastBits[channel] ^= value << (32 - leading[channel] - meaningful[channel]);
+    bits = lastBits[channel];
+    return true;
+}
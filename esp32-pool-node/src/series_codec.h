@@ -0,0 +1,136 @@
+#ifndef SERIES_CODEC_H
+#define SERIES_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Compressed time-series blocks for buffered reading history (Gorilla-style).
+// Plain C++ with no Arduino dependencies (see tools/series_decode.cpp).
+//
+// Block layout (little-endian):
+//   magic "PS"(2) version(1) encoding(1) count(2) bits_length(2) run_count(2) now_s(4)
+//   bitstream(bits_length) runs(run_count x 3)
+// The bitstream holds, per sample, the timestamp as a delta-of-delta, the
+// sequence number as its step from the previous one less one (a single '0'
+// bit for consecutive readings), then each channel present in that sample's flags. Flags (presence bits and the
+// water level) change rarely and are run-length encoded: flags(1) length(2).
+//
+// The first sample stores its timestamp and sequence number as raw 32-bit values.
+// Integers (timestamp delta-of-delta, sequence steps, quantized deltas) use zigzag buckets:
+//   '0' zero, '10'+7 bits, '110'+9 bits, '1110'+12 bits, '1111'+32 bits
+// SERIES_XOR stores float32 bits XORed with the previous value of the channel:
+//   '0' same value, '10' meaningful bits inside the previous window,
+//   '11' leading(5) length-1(5) meaningful bits
+#define SERIES_MAGIC_0 'P'
+#define SERIES_MAGIC_1 'S'
+#define SERIES_VERSION 2
+#define SERIES_HEADER_SIZE 14
+#define SERIES_RUN_SIZE 3
+
+// Same bits as BufferedReading::flags
+#define SERIES_HAS_TEMPERATURE  0x01
+#define SERIES_HAS_WATER_LEVEL  0x02
+#define SERIES_WATER_OK         0x04
+#define SERIES_HAS_BATTERY      0x08
+
+enum SeriesEncoding {
+    SERIES_QUANTIZED = 0,   // 0.01 F, 1 mV, 1 %: lossless for BufferedReading
+    SERIES_XOR = 1          // Bit-exact float32
+};
+
+enum SeriesChannel {
+    SERIES_TEMPERATURE_F = 0,
+    SERIES_BATTERY_VOLTAGE = 1,
+    SERIES_BATTERY_PERCENT = 2,
+    SERIES_CHANNEL_COUNT = 3
+};
+
+struct SeriesSample {
+    uint32_t timestampS;
+    uint32_t sequence;                    // Per-device reading sequence number
+    float values[SERIES_CHANNEL_COUNT];   // Only channels present in flags are stored
+    uint8_t flags;                        // SERIES_* bits
+};
+
+struct SeriesBlockInfo {
+    uint8_t encoding;
+    uint16_t count;
+    uint32_t nowS;                        // Node clock when the block was finished
+    size_t blockLength;                   // Bytes, to step through concatenated blocks
+};
+
+// Streaming encoder: samples are appended one at a time into a caller buffer;
+// nothing but the block itself and a few words of state are kept
+class SeriesEncoder {
+public:
+    void begin(uint8_t* buffer, size_t capacity, uint8_t encoding);
+
+    // False if the sample does not fit; the block is left as it was
+    bool append(const SeriesSample& sample);
+
+    // Writes the header and moves the runs behind the bitstream; returns the block size
+    size_t finish(uint32_t nowS);
+
+    uint16_t getCount() const { return count; }
+    size_t getLength() const;   // Block size if finished now
+
+private:
+    struct State {
+        size_t bitPosition;
+        uint16_t runCount;
+        uint8_t runFlags;
+        uint16_t runLength;
+        uint32_t lastTimestamp;
+        int32_t lastDelta;
+        uint32_t lastSequence;
+        uint32_t lastBits[SERIES_CHANNEL_COUNT];
+        uint8_t leading[SERIES_CHANNEL_COUNT];
+        uint8_t meaningful[SERIES_CHANNEL_COUNT];
+    };
+
+    uint8_t* buffer = nullptr;
+    size_t capacity = 0;
+    uint8_t encoding = SERIES_QUANTIZED;
+    uint16_t count = 0;
+    State state = {};
+
+    bool writeBits(uint32_t value, int bits);
+    bool writeInteger(int32_t value);
+    bool writeXor(int channel, uint32_t bits);
+    bool writeRun();
+    size_t bitBytes() const { return (state.bitPosition + 7) / 8; }
+};
+
+class SeriesDecoder {
+public:
+    SeriesDecoder(const uint8_t* data, size_t length);
+
+    // Validates the header; false if this is not a complete block
+    bool begin(SeriesBlockInfo& info);
+    bool next(SeriesSample& sample);
+
+private:
+    const uint8_t* data;
+    size_t length;
+    uint8_t encoding;
+    uint16_t remaining;
+    size_t bitPosition;
+    size_t bitEnd;
+    const uint8_t* runs;
+    uint16_t runsLeft;
+    uint8_t runFlags;
+    uint16_t runLeft;
+    uint32_t lastTimestamp;
+    int32_t lastDelta;
+    uint32_t lastSequence;
+    uint32_t lastBits[SERIES_CHANNEL_COUNT];
+    uint8_t leading[SERIES_CHANNEL_COUNT];
+    uint8_t meaningful[SERIES_CHANNEL_COUNT];
+    bool first;
+
+    bool readBits(int bits, uint32_t& value);
+    bool readInteger(int32_t& value);
+    bool readXor(int channel, uint32_t& bits);
+};
+
+#endif
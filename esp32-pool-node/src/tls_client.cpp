@@ -0,0 +1,338 @@
+#include "tls_client.h"
+#include "config.h"
+#include "power_manager.h"
+#include <esp_attr.h>
+#include <mbedtls/error.h>
+
+// Serialized mbedtls session, kept in RTC slow memory across deep sleep
+RTC_DATA_ATTR static uint8_t rtcSessionData[MQTT_TLS_SESSION_CACHE_SIZE];
+RTC_DATA_ATTR static uint16_t rtcSessionLength = 0;
+
+static int tlsSend(void* ctx, const unsigned char* buf, size_t len) {
+    WiFiClient* client = (WiFiClient*)ctx;
+    if (!client->connected()) {
+        return MBEDTLS_ERR_SSL_CONN_EOF;
+    }
+    int written = client->write(buf, len);
+    return written > 0 ? written : MBEDTLS_ERR_SSL_WANT_WRITE;
+}
+
+static int tlsRecv(void* ctx, unsigned char* buf, size_t len) {
+    WiFiClient* client = (WiFiClient*)ctx;
+    int avail = client->available();
+    if (avail <= 0) {
+        return client->connected() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_SSL_CONN_EOF;
+    }
+    int received = client->read(buf, len < (size_t)avail ? len : (size_t)avail);
+    return received > 0 ? received : MBEDTLS_ERR_SSL_WANT_READ;
+}
+
+// TlsClient Implementation
+TlsClient::TlsClient()
+    : caCert(nullptr), serverName(nullptr), connectTimeoutMs(MQTT_TLS_HANDSHAKE_TIMEOUT_MS), configured(false), sessionOpen(false), peekByte(-1),
+      lastHandshakeMs(0), sessionResumed(false) {
+    mbedtls_ssl_init(&ssl);
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_x509_crt_init(&caChain);
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&drbg);
+}
+
+TlsClient::~TlsClient() {
+    stop();
+    mbedtls_ssl_free(&ssl);
+    mbedtls_ssl_config_free(&conf);
+    mbedtls_x509_crt_free(&caChain);
+    mbedtls_ctr_drbg_free(&drbg);
+    mbedtls_entropy_free(&entropy);
+}
+
+void TlsClient::setCACert(const char* caCert) {
+    this->caCert = caCert;
+}
+
+void TlsClient::setServerName(const char* serverName) {
+    this->serverName = serverName;
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port);
+}
+
+int TlsClient::connect(const char* host, uint16_t port) {
+    stop();
+    sessionResumed = false;
+
+    if (!setupConfig()) {
+        return 0;
+    }
+
+    unsigned long startMs = millis();
+    if (!tcpClient.connect(host, port, connectTimeoutMs)) {
+        Serial.printf("TLS: TCP connection to %s:%d failed\n", host, port);
+        return 0;
+    }
+    tcpClient.setNoDelay(true);
+
+    // A fresh SSL context per connection; the config and RNG are reused
+    mbedtls_ssl_free(&ssl);
+    mbedtls_ssl_init(&ssl);
+    int ret = mbedtls_ssl_setup(&ssl, &conf);
+    if (ret == 0) {
+        ret = mbedtls_ssl_set_hostname(&ssl, serverName ? serverName : host);
+    }
+    if (ret != 0) {
+        logError("setup", ret);
+        tcpClient.stop();
+        return 0;
+    }
+    mbedtls_ssl_set_bio(&ssl, &tcpClient, tlsSend, tlsRecv, nullptr);
+
+    bool offered = restoreSession();
+
+    // Key exchange and certificate checks are the most CPU-heavy part of a wake
+    CpuBoost boost;
+    unsigned long startUs = micros();
+    while ((ret = mbedtls_ssl_handshake(&ssl)) != 0) {
+        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            logError("handshake", ret);
+            // A stale cached session must not block the next full handshake
+            clearSessionCache();
+            tcpClient.stop();
+            return 0;
+        }
+        if (millis() - startMs > connectTimeoutMs) {
+            Serial.println("TLS: handshake timed out");
+            tcpClient.stop();
+            return 0;
+        }
+        delay(1);
+    }
+    lastHandshakeMs = (micros() - startUs) / 1000;
+
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    sessionResumed = offered && mbedtls_ssl_session_reused(&ssl) == 1;
+#else
+    // 2.x has no public resumption flag; a resumed session keeps its master secret
+    mbedtls_ssl_session negotiated;
+    mbedtls_ssl_session_init(&negotiated);
+    if (offered && mbedtls_ssl_get_session(&ssl, &negotiated) == 0) {
+        sessionResumed = memcmp(negotiated.master, offeredMaster, sizeof(offeredMaster)) == 0;
+    }
+    mbedtls_ssl_session_free(&negotiated);
+#endif
+
+    Serial.printf("TLS: %s handshake with %s in %lu ms (%s)\n",
+                 sessionResumed ? "abbreviated" : "full", host, lastHandshakeMs,
+                 mbedtls_ssl_get_ciphersuite(&ssl));
+
+    // Re-save even after resumption: the server may have issued a new ticket
+    sessionOpen = true;
+    saveSession();
+    return 1;
+}
+
+size_t TlsClient::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t TlsClient::write(const uint8_t* buf, size_t size) {
+    if (!sessionOpen) {
+        return 0;
+    }
+
+    CpuBoost boost;
+    size_t sent = 0;
+    unsigned long start = millis();
+    while (sent < size) {
+        int ret = mbedtls_ssl_write(&ssl, buf + sent, size - sent);
+        if (ret > 0) {
+            sent += ret;
+        } else if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+            if (millis() - start > MQTT_TIMEOUT_MS) {
+                break;
+            }
+            delay(1);
+        } else {
+            logError("write", ret);
+            stop();
+            break;
+        }
+    }
+    return sent;
+}
+
+int TlsClient::available() {
+    if (!sessionOpen) {
+        return 0;
+    }
+
+    // A zero-length read processes any pending record without consuming data
+    int ret = mbedtls_ssl_read(&ssl, nullptr, 0);
+    if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        if (ret != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
+            logError("read", ret);
+        }
+        stop();
+        return 0;
+    }
+    return mbedtls_ssl_get_bytes_avail(&ssl) + (peekByte >= 0 ? 1 : 0);
+}
+
+int TlsClient::read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int TlsClient::read(uint8_t* buf, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+
+    size_t offset = 0;
+    if (peekByte >= 0) {
+        buf[offset++] = peekByte;
+        peekByte = -1;
+        if (offset == size) {
+            return offset;
+        }
+    }
+
+    if (!sessionOpen) {
+        return offset > 0 ? offset : -1;
+    }
+
+    int ret = mbedtls_ssl_read(&ssl, buf + offset, size - offset);
+    if (ret > 0) {
+        return offset + ret;
+    }
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        stop();
+    }
+    return offset > 0 ? offset : -1;
+}
+
+int TlsClient::peek() {
+    if (peekByte < 0) {
+        uint8_t b;
+        if (read(&b, 1) == 1) {
+            peekByte = b;
+        }
+    }
+    return peekByte;
+}
+
+void TlsClient::flush() {
+    tcpClient.flush();
+}
+
+void TlsClient::stop() {
+    if (sessionOpen) {
+        mbedtls_ssl_close_notify(&ssl);
+        sessionOpen = false;
+    }
+    peekByte = -1;
+    tcpClient.stop();
+}
+
+uint8_t TlsClient::connected() {
+    if (!sessionOpen) {
+        return peekByte >= 0;
+    }
+    return tcpClient.connected() || tcpClient.available() > 0;
+}
+
+void TlsClient::clearSessionCache() {
+    rtcSessionLength = 0;
+}
+
+bool TlsClient::setupConfig() {
+    if (configured) {
+        return true;
+    }
+
+    int ret = mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy,
+                                    (const unsigned char*)DEVICE_ID, strlen(DEVICE_ID));
+    if (ret == 0) {
+        ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT,
+                                          MBEDTLS_SSL_TRANSPORT_STREAM,
+                                          MBEDTLS_SSL_PRESET_DEFAULT);
+    }
+    if (ret != 0) {
+        logError("config", ret);
+        return false;
+    }
+
+    if (caCert) {
+        ret = mbedtls_x509_crt_parse(&caChain, (const unsigned char*)caCert, strlen(caCert) + 1);
+        if (ret != 0) {
+            logError("CA certificate", ret);
+            return false;
+        }
+        mbedtls_ssl_conf_ca_chain(&conf, &caChain, nullptr);
+        mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    } else {
+        Serial.println("TLS: WARNING no CA certificate, server identity is not verified");
+        mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_NONE);
+    }
+
+    mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+    mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+
+    configured = true;
+    return true;
+}
+
+bool TlsClient::restoreSession() {
+    if (rtcSessionLength == 0) {
+        return false;
+    }
+
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+
+    bool restored = false;
+    int ret = mbedtls_ssl_session_load(&session, rtcSessionData, rtcSessionLength);
+    if (ret == 0) {
+        ret = mbedtls_ssl_set_session(&ssl, &session);
+    }
+    if (ret == 0) {
+#if MBEDTLS_VERSION_NUMBER < 0x03000000
+        memcpy(offeredMaster, session.master, sizeof(offeredMaster));
+#endif
+        restored = true;
+    } else {
+        logError("session restore", ret);
+        clearSessionCache();
+    }
+
+    mbedtls_ssl_session_free(&session);
+    return restored;
+}
+
+void TlsClient::saveSession() {
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+
+    size_t length = 0;
+    int ret = mbedtls_ssl_get_session(&ssl, &session);
+    if (ret == 0) {
+        ret = mbedtls_ssl_session_save(&session, rtcSessionData, sizeof(rtcSessionData), &length);
+    }
+
+    if (ret == 0) {
+        rtcSessionLength = length;
+        Serial.printf("TLS: cached %u byte session in RTC memory\n", (unsigned)length);
+    } else {
+        logError("session save", ret);
+        clearSessionCache();
+    }
+
+    mbedtls_ssl_session_free(&session);
+}
+
+void TlsClient::logError(const char* what, int ret) {
+    char message[96];
+    mbedtls_strerror(ret, message, sizeof(message));
+    Serial.printf("TLS %s failed: -0x%04X %s\n", what, -ret, message);
+}
@@ -0,0 +1,72 @@
+#ifndef TLS_CLIENT_H
+#define TLS_CLIENT_H
+
+#include <WiFi.h>
+#include <mbedtls/version.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/x509_crt.h>
+
+// TLS client for the MQTT transports.
+// The negotiated session (ID or ticket) is saved to RTC memory after each
+// handshake so the next wake from deep sleep can do an abbreviated handshake
+// instead of a full certificate exchange.
+class TlsClient : public Client {
+public:
+    TlsClient();
+    ~TlsClient();
+
+    void setCACert(const char* caCert);
+    // Name sent as SNI and matched against the certificate; defaults to the connect() host
+    void setServerName(const char* serverName);
+    // Bounds the TCP connect and the handshake of the next connect()
+    void setConnectTimeout(unsigned long timeoutMs) { connectTimeoutMs = timeoutMs; }
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+
+    // Handshake telemetry for the most recent connect()
+    unsigned long getLastHandshakeMs() const { return lastHandshakeMs; }
+    bool wasSessionResumed() const { return sessionResumed; }
+    int fd() const { return tcpClient.fd(); }
+    static void clearSessionCache();
+
+private:
+    WiFiClient tcpClient;
+    const char* caCert;
+    const char* serverName;
+    unsigned long connectTimeoutMs;
+
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    mbedtls_x509_crt caChain;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context drbg;
+
+    bool configured;
+    bool sessionOpen;
+    int peekByte;
+    unsigned long lastHandshakeMs;
+    bool sessionResumed;
+#if MBEDTLS_VERSION_NUMBER < 0x03000000
+    unsigned char offeredMaster[48];
+#endif
+
+    bool setupConfig();
+    bool restoreSession();
+    void saveSession();
+    void logError(const char* what, int ret);
+};
+
+#endif
@@ -0,0 +1,218 @@
+#include "trace_format.h"
+#include <string.h>
+
+static void putUint16(uint8_t* out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+}
+
+static void putUint32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint16_t getUint16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+}
+
+static uint32_t getUint32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+// TraceWriter Implementation
+void TraceWriter::begin(uint8_t* buffer, size_t capacity, const char* deviceId,
+                        uint32_t startMs, uint32_t nodeClockS) {
+    this->buffer = buffer;
+    this->capacity = capacity > 0xFFFF ? 0xFFFF : capacity;
+    lastMs = startMs;
+    truncated = false;
+
+    size_t idLength = strnlen(deviceId, TRACE_ID_MAX);
+    length = TRACE_CHUNK_HEADER_SIZE + idLength;
+    if (length > this->capacity) {
+        length = 0;
+        truncated = true;
+        return;
+    }
+
+    buffer[0] = TRACE_MAGIC_0;
+    buffer[1] = TRACE_MAGIC_1;
+    buffer[2] = TRACE_VERSION;
+    buffer[3] = 0;
+    putUint16(&buffer[4], length);
+    putUint32(&buffer[6], startMs);
+    putUint32(&buffer[10], nodeClockS);
+    buffer[14] = idLength;
+    memcpy(&buffer[TRACE_CHUNK_HEADER_SIZE], deviceId, idLength);
+}
+
+bool TraceWriter::beginOperation(uint32_t timeMs, uint8_t op, const char* sensorId) {
+    uint8_t payload[2 + TRACE_ID_MAX];
+    size_t idLength = strnlen(sensorId, TRACE_ID_MAX);
+    payload[0] = op;
+    payload[1] = idLength;
+    memcpy(&payload[2], sensorId, idLength);
+    return putRecord(TRACE_BEGIN, timeMs, payload, 2 + idLength);
+}
+
+bool TraceWriter::endOperation(uint32_t timeMs) {
+    return putRecord(TRACE_END, timeMs, nullptr, 0);
+}
+
+bool TraceWriter::digital(uint32_t timeMs, uint8_t pin, uint8_t level) {
+    uint8_t payload[2] = {pin, level};
+    return putRecord(TRACE_DIGITAL, timeMs, payload, sizeof(payload));
+}
+
+bool TraceWriter::value(uint32_t timeMs, uint8_t channel, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint8_t payload[5];
+    payload[0] = channel;
+    putUint32(&payload[1], bits);
+    return putRecord(TRACE_VALUE, timeMs, payload, sizeof(payload));
+}
+
+size_t TraceWriter::finish() {
+    if (length == 0) {
+        return 0;
+    }
+    buffer[3] = truncated ? TRACE_FLAG_TRUNCATED : 0;
+    putUint16(&buffer[4], length);
+    return length;
+}
+
+bool TraceWriter::putRecord(uint8_t type, uint32_t timeMs, const uint8_t* payload, size_t payloadLength) {
+    // Once a record is dropped the rest of the chunk is dropped too, so the
+    // records that remain are a complete prefix of the cycle
+    if (truncated) {
+        return false;
+    }
+
+    uint8_t header[6];
+    size_t headerLength = 0;
+    header[headerLength++] = type;
+
+    uint32_t delta = timeMs - lastMs;
+    do {
+        uint8_t byte = delta & 0x7F;
+        delta >>= 7;
+        header[headerLength++] = byte | (delta ? 0x80 : 0);
+    } while (delta);
+
+    if (length + headerLength + payloadLength > capacity) {
+        truncated = true;
+        return false;
+    }
+
+    memcpy(&buffer[length], header, headerLength);
+    length += headerLength;
+    if (payloadLength > 0) {
+        memcpy(&buffer[length], payload, payloadLength);
+        length += payloadLength;
+    }
+    lastMs = timeMs;
+    return true;
+}
+
+// TraceReader Implementation
+TraceReader::TraceReader(const uint8_t* data, size_t length)
+    : data(data), length(length), chunkEnd(0), position(0), timeMs(0) {
+}
+
+bool TraceReader::nextChunk(TraceChunkInfo& info) {
+    size_t offset = chunkEnd;
+
+    while (offset + TRACE_CHUNK_HEADER_SIZE <= length) {
+        const uint8_t* header = &data[offset];
+        uint16_t chunkLength = getUint16(&header[4]);
+        uint8_t idLength = header[14];
+
+        bool valid = header[0] == TRACE_MAGIC_0 && header[1] == TRACE_MAGIC_1 &&
+                     header[2] == TRACE_VERSION && idLength <= TRACE_ID_MAX &&
+                     chunkLength >= TRACE_CHUNK_HEADER_SIZE + idLength &&
+                     offset + chunkLength <= length;
+        if (!valid) {
+            offset++;
+            continue;
+        }
+
+        info.flags = header[3];
+        info.startMs = getUint32(&header[6]);
+        info.nodeClockS = getUint32(&header[10]);
+        memcpy(info.deviceId, &header[TRACE_CHUNK_HEADER_SIZE], idLength);
+        info.deviceId[idLength] = '\0';
+
+        chunkEnd = offset + chunkLength;
+        position = offset + TRACE_CHUNK_HEADER_SIZE + idLength;
+        timeMs = info.startMs;
+        return true;
+    }
+
+    chunkEnd = length;
+    return false;
+}
+
+bool TraceReader::next(TraceRecord& record) {
+    if (position >= chunkEnd) {
+        return false;
+    }
+
+    memset(&record, 0, sizeof(record));
+    record.type = data[position++];
+
+    uint32_t delta = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (position >= chunkEnd) {
+            return false;
+        }
+        uint8_t byte = data[position++];
+        delta |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    timeMs += delta;
+    record.timeMs = timeMs;
+
+    size_t remaining = chunkEnd - position;
+    switch (record.type) {
+        case TRACE_BEGIN: {
+            if (remaining < 2 || data[position + 1] > TRACE_ID_MAX || remaining < 2u + data[position + 1]) {
+                return false;
+            }
+            record.op = data[position];
+            uint8_t idLength = data[position + 1];
+            memcpy(record.sensorId, &data[position + 2], idLength);
+            record.sensorId[idLength] = '\0';
+            position += 2 + idLength;
+            return true;
+        }
+        case TRACE_END:
+            return true;
+        case TRACE_DIGITAL:
+            if (remaining < 2) {
+                return false;
+            }
+            record.pin = data[position];
+            record.level = data[position + 1];
+            position += 2;
+            return true;
+        case TRACE_VALUE: {
+            if (remaining < 5) {
+                return false;
+            }
+            record.channel = data[position];
+            uint32_t bits = getUint32(&data[position + 1]);
+            memcpy(&record.value, &bits, sizeof(bits));
+            position += 5;
+            return true;
+        }
+        default:
+            // Unknown record type: the rest of the chunk cannot be parsed
+            position = chunkEnd;
+            return false;
+    }
+}
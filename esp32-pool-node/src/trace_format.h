@@ -0,0 +1,109 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Compact sensor I/O trace, recorded on the node and replayed on Linux.
+// Plain C++ with no Arduino dependencies (see replay/sensor_replay.cpp).
+//
+// A trace is a sequence of self-contained chunks (one per wake cycle), so
+// flash files and MQTT captures can simply be concatenated. Chunk layout
+// (little-endian):
+//   magic "PT"(2) version(1) flags(1) length(2) start_ms(4) node_clock_s(4)
+//   id_len(1) device_id(id_len) records...
+// Each record is type(1) dt_ms(varint, since the previous record) payload:
+//   BEGIN    op(1) id_len(1) sensor_id       start of initialize()/readData()
+//   END      -                              end of that operation
+//   DIGITAL  pin(1) level(1)                 pin level changed (first read is always kept)
+//   VALUE    channel(1) float32              driver reading, bit-exact (e.g. -196.6)
+#define TRACE_MAGIC_0 'P'
+#define TRACE_MAGIC_1 'T'
+#define TRACE_VERSION 1
+#define TRACE_ID_MAX 16
+#define TRACE_CHUNK_HEADER_SIZE 15
+
+#define TRACE_FLAG_TRUNCATED 0x01   // Chunk buffer filled up; later records were dropped
+
+enum TraceRecordType {
+    TRACE_BEGIN = 1,
+    TRACE_END = 2,
+    TRACE_DIGITAL = 3,
+    TRACE_VALUE = 4
+};
+
+enum TraceOperation {
+    TRACE_OP_INIT = 0,
+    TRACE_OP_READ = 1
+};
+
+enum TraceChannel {
+    TRACE_TEMPERATURE_F = 0,
+    TRACE_BATTERY_VOLTAGE = 1,
+    TRACE_BATTERY_PERCENT = 2,
+    TRACE_BATTERY_PRESENT = 3   // MAX17048 begin() result, 1 or 0
+};
+
+struct TraceChunkInfo {
+    char deviceId[TRACE_ID_MAX + 1];
+    uint8_t flags;
+    uint32_t startMs;
+    uint32_t nodeClockS;
+};
+
+struct TraceRecord {
+    uint8_t type;
+    uint32_t timeMs;            // Absolute device millis()
+    uint8_t op;                 // BEGIN
+    char sensorId[TRACE_ID_MAX + 1];
+    uint8_t pin;                // DIGITAL
+    uint8_t level;
+    uint8_t channel;            // VALUE
+    float value;
+};
+
+class TraceWriter {
+public:
+    void begin(uint8_t* buffer, size_t capacity, const char* deviceId,
+               uint32_t startMs, uint32_t nodeClockS);
+
+    // Each returns false (and marks the chunk truncated) when the buffer is full
+    bool beginOperation(uint32_t timeMs, uint8_t op, const char* sensorId);
+    bool endOperation(uint32_t timeMs);
+    bool digital(uint32_t timeMs, uint8_t pin, uint8_t level);
+    bool value(uint32_t timeMs, uint8_t channel, float value);
+
+    // Finalizes the header; returns the chunk size in bytes
+    size_t finish();
+
+    size_t getLength() const { return length; }
+    bool isTruncated() const { return truncated; }
+
+private:
+    uint8_t* buffer = nullptr;
+    size_t capacity = 0;
+    size_t length = 0;
+    uint32_t lastMs = 0;
+    bool truncated = false;
+
+    bool putRecord(uint8_t type, uint32_t timeMs, const uint8_t* payload, size_t payloadLength);
+};
+
+class TraceReader {
+public:
+    TraceReader(const uint8_t* data, size_t length);
+
+    // Advances to the next valid chunk; skips bytes that are not a chunk header
+    bool nextChunk(TraceChunkInfo& info);
+    // Next record of the current chunk
+    bool next(TraceRecord& record);
+
+private:
+    const uint8_t* data;
+    size_t length;
+    size_t chunkEnd;
+    size_t position;
+    uint32_t timeMs;
+};
+
+#endif
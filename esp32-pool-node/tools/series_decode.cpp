@@ -0,0 +1,86 @@
+// Decodes compressed history blocks (HISTORY_FORMAT_SERIES) on Linux.
+//
+// Build from esp32-pool-node/:
+//   g++ -O2 -std=c++17 -Isrc tools/series_decode.cpp src/series_codec.cpp -o /tmp/series_decode
+//
+// Run:
+//   mosquitto_sub -t 'poolio/history/#' -N > history.bin
+//   /tmp/series_decode history.bin [more.bin ...]
+//
+// Blocks can be concatenated; bytes that are not a valid block are skipped.
+// Each block is printed as one "HISTORY {json}" line with the same fields as the
+// JSON poolio/history payload, so existing consumers only need the decoder in front.
+
+#include "series_codec.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static bool readFile(const char* path, std::vector<uint8_t>& data) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static void printBlock(const SeriesBlockInfo& info, SeriesDecoder& decoder) {
+    printf("HISTORY {\"now_s\":%u,\"encoding\":\"%s\",\"readings\":[", info.nowS,
+           info.encoding == SERIES_XOR ? "xor" : "quantized");
+
+    SeriesSample sample;
+    bool first = true;
+    while (decoder.next(sample)) {
+        printf("%s{\"seq\":%u,\"t\":%u", first ? "" : ",", sample.sequence, sample.timestampS);
+        if (sample.flags & SERIES_HAS_TEMPERATURE) {
+            printf(",\"temperature_f\":%.9g", sample.values[SERIES_TEMPERATURE_F]);
+        }
+        if (sample.flags & SERIES_HAS_WATER_LEVEL) {
+            printf(",\"water_level\":%s", (sample.flags & SERIES_WATER_OK) ? "true" : "false");
+        }
+        if (sample.flags & SERIES_HAS_BATTERY) {
+            printf(",\"battery_voltage\":%.9g,\"battery_percentage\":%.9g",
+                   sample.values[SERIES_BATTERY_VOLTAGE], sample.values[SERIES_BATTERY_PERCENT]);
+        }
+        printf("}");
+        first = false;
+    }
+    printf("]}\n");
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s history.bin [...]\n", argv[0]);
+        return 1;
+    }
+
+    unsigned long blocks = 0;
+    unsigned long skippedBytes = 0;
+    for (int i = 1; i < argc; i++) {
+        std::vector<uint8_t> data;
+        if (!readFile(argv[i], data)) {
+            fprintf(stderr, "Cannot open %s\n", argv[i]);
+            return 1;
+        }
+
+        size_t offset = 0;
+        while (offset < data.size()) {
+            SeriesDecoder decoder(data.data() + offset, data.size() - offset);
+            SeriesBlockInfo info;
+            if (!decoder.begin(info)) {
+                offset++;
+                skippedBytes++;
+                continue;
+            }
+            printBlock(info, decoder);
+            offset += info.blockLength;
+            blocks++;
+        }
+    }
+
+    fprintf(stderr, "%lu blocks, %lu bytes skipped\n", blocks, skippedBytes);
+    return 0;
+}
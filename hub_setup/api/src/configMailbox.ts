@@ -0,0 +1,124 @@
+// Per-device configuration mailboxes.
+// Desired settings live in a retained message on poolio/config/<device_id>;
+// a node reads it right after connecting, applies revisions newer than the
+// one in its NVS and acknowledges on poolio/config_ack. The broker keeps the
+// mailbox, so a node that sleeps through an update still gets it on its next wake.
+
+export const MAILBOX_TOPIC_PREFIX = 'poolio/config/';
+
+export interface ConfigAck {
+  device_id: string;
+  rev: number;
+  applied: Record<string, number>;
+  rejected: string[];
+}
+
+interface DeviceConfig {
+  desired: Record<string, number>;  // Fields to set, without "rev"
+  desiredRev: number;
+  reportedRev: number;              // "config_rev" from the node's gateway messages
+  hasMailbox: boolean;
+  lastAck?: ConfigAck & { received: string };
+}
+
+// Field ranges mirror the node's node_config.cpp table; the node validates again
+const FIELD_RANGES: Record<string, [number, number, boolean]> = {
+  sleep_duration: [10, 86400, true],
+  temperature_retries: [1, 5, true],
+  float_switch_samples: [1, 123, true],  // Acquire budget less one temperature attempt; the node also checks it with temperature_retries
+  low_battery_v: [3.0, 4.2, false],
+  critical_battery_v: [2.8, 4.0, false],
+  sensor_failure_threshold: [1, 20, true],
+  sensor_backoff_initial_s: [10, 3600, true],
+  sensor_backoff_max_s: [60, 43200, true],
+  log_level: [0, 5, true]
+};
+
+export class ConfigMailbox {
+  private devices = new Map<string, DeviceConfig>();
+
+  private device(deviceId: string): DeviceConfig {
+    let device = this.devices.get(deviceId);
+    if (!device) {
+      device = { desired: {}, desiredRev: 0, reportedRev: 0, hasMailbox: false };
+      this.devices.set(deviceId, device);
+    }
+    return device;
+  }
+
+  // Retained mailbox read back from the broker after a hub restart
+  restore(deviceId: string, mailbox: any): void {
+    if (typeof mailbox?.rev !== 'number') {
+      return;
+    }
+    const device = this.device(deviceId);
+    if (mailbox.rev < device.desiredRev) {
+      return;
+    }
+    const { rev, ...fields } = mailbox;
+    device.desiredRev = rev;
+    device.desired = fields;
+    device.hasMailbox = true;
+  }
+
+  reported(deviceId: string, rev: number): void {
+    this.device(deviceId).reportedRev = rev;
+  }
+
+  acknowledge(ack: ConfigAck): void {
+    const device = this.device(ack.device_id);
+    device.reportedRev = Math.max(device.reportedRev, ack.rev);
+    device.lastAck = { ...ack, received: new Date().toISOString() };
+  }
+
+  // Returns invalid field names; nothing is changed if there are any
+  validate(fields: Record<string, unknown>): string[] {
+    return Object.entries(fields)
+      .filter(([key, value]) => {
+        const range = FIELD_RANGES[key];
+        if (!range || typeof value !== 'number') {
+          return true;
+        }
+        const [min, max, integral] = range;
+        return value < min || value > max || (integral && !Number.isInteger(value));
+      })
+      .map(([key]) => key);
+  }
+
+  // Merges fields into the desired settings; returns the mailbox to publish
+  update(deviceId: string, fields: Record<string, number>): Record<string, number> {
+    const device = this.device(deviceId);
+    device.desiredRev = Math.max(device.desiredRev, device.reportedRev) + 1;
+    device.desired = { ...device.desired, ...fields };
+    device.hasMailbox = true;
+    return { rev: device.desiredRev, ...device.desired };
+  }
+
+  // Devices seen with no mailbox yet; an empty one at their current revision
+  // lets them stop waiting as soon as the retained message arrives
+  missing(): Array<{ device_id: string; mailbox: Record<string, number> }> {
+    const result: Array<{ device_id: string; mailbox: Record<string, number> }> = [];
+    this.devices.forEach((device, deviceId) => {
+      if (!device.hasMailbox) {
+        device.hasMailbox = true;
+        device.desiredRev = device.reportedRev;
+        result.push({ device_id: deviceId, mailbox: { rev: device.reportedRev } });
+      }
+    });
+    return result;
+  }
+
+  status(deviceId: string): object | undefined {
+    const device = this.devices.get(deviceId);
+    if (!device) {
+      return undefined;
+    }
+    return {
+      desired: device.desired,
+      desired_rev: device.desiredRev,
+      reported_rev: device.reportedRev,
+      pending: device.desiredRev > device.reportedRev,
+      last_ack: device.lastAck
+    };
+  }
+}
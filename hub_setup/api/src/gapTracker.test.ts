@@ -0,0 +1,93 @@
+import { test } from 'node:test';
+import assert from 'node:assert/strict';
+import { GapTracker } from './gapTracker';
+
+const OPTIONS = { graceMs: 1000, retryMs: 5000, maxRequests: 3, maxTracked: 48 };
+
+function device(tracker: GapTracker, deviceId: string): any {
+  return tracker.summary()[deviceId];
+}
+
+test('a gap is requested after the grace period as one range', () => {
+  const tracker = new GapTracker(OPTIONS);
+  tracker.record('node', 10, 1, false, 0);
+  tracker.record('node', 14, 1, false, 0);
+
+  assert.deepEqual(tracker.due(500), []);
+  assert.deepEqual(tracker.due(1000), [{ device_id: 'node', from: 11, to: 13 }]);
+  assert.deepEqual(tracker.due(2000), []);  // Within retryMs
+});
+
+test('backfilled readings close the gap', () => {
+  const tracker = new GapTracker(OPTIONS);
+  tracker.record('node', 10, 1, false, 0);
+  tracker.record('node', 13, 1, false, 0);
+  tracker.record('node', 11, undefined, true, 0);
+  tracker.record('node', 11, undefined, true, 0);  // Duplicate
+
+  const summary = device(tracker, 'node');
+  assert.deepEqual(summary.missing, [12]);
+  assert.equal(summary.backfilled, 1);
+  assert.equal(summary.received, 3);
+});
+
+test('a new epoch drops readings lost with the RTC memory', () => {
+  const tracker = new GapTracker(OPTIONS);
+  tracker.record('node', 10, 1, false, 0);
+  tracker.record('node', 14, 1, false, 0);
+  // Power-on: numbers 15-19 were never used, 11-13 are gone
+  tracker.record('node', 21, 20, false, 0);
+
+  const summary = device(tracker, 'node');
+  assert.equal(summary.epoch, 20);
+  assert.deepEqual(summary.missing, [20]);
+  assert.equal(summary.lost, 3);
+});
+
+test('only the last maxTracked readings of a jump are requested', () => {
+  const tracker = new GapTracker(OPTIONS);
+  tracker.record('node', 10, 1, false, 0);
+  tracker.record('node', 110, 1, false, 0);
+
+  const summary = device(tracker, 'node');
+  assert.equal(summary.missing.length, 48);
+  assert.equal(summary.missing[0], 62);
+  assert.equal(summary.lost, 110 - 11 - 48);
+});
+
+test('without a buffer (maxTracked 0) a gap is lost at once', () => {
+  const tracker = new GapTracker({ ...OPTIONS, maxTracked: 0 });
+  tracker.record('leaf', 10, 1, false, 0);
+  tracker.record('leaf', 14, 1, false, 0);
+
+  const summary = device(tracker, 'leaf');
+  assert.deepEqual(summary.missing, []);
+  assert.equal(summary.lost, 3);
+  assert.deepEqual(tracker.due(1000), []);
+});
+
+test('closeBackfill counts numbers below oldest_seq as lost', () => {
+  const tracker = new GapTracker(OPTIONS);
+  tracker.record('node', 10, 1, false, 0);
+  tracker.record('node', 16, 1, false, 0);
+  tracker.closeBackfill('node', 11, 15, 13);
+
+  const summary = device(tracker, 'node');
+  assert.deepEqual(summary.missing, [13, 14, 15]);
+  assert.equal(summary.lost, 2);
+
+  tracker.closeBackfill('other', 11, 15, 13);  // Unknown device
+  assert.equal(device(tracker, 'other'), undefined);
+});
+
+test('a reading is counted as lost after maxRequests', () => {
+  const tracker = new GapTracker(OPTIONS);
+  tracker.record('node', 10, 1, false, 0);
+  tracker.record('node', 12, 1, false, 0);
+
+  for (let request = 0; request < 3; request++) {
+    assert.equal(tracker.due(1000 + request * 5000).length, 1);
+  }
+  assert.deepEqual(tracker.due(1000 + 3 * 5000), []);
+  assert.equal(device(tracker, 'node').lost, 1);
+});
@@ -0,0 +1,151 @@
+// Per-device sequence tracking for the QoS0 uplink.
+// Every node reading carries a "seq" number; numbers that never arrive are
+// requested again from the node's reading buffer with a backfill command.
+
+export interface BackfillRequest {
+  device_id: string;
+  from: number;
+  to: number;
+}
+
+export interface GapTrackerOptions {
+  graceMs: number;      // Buffered readings normally arrive with the node's next cycle
+  retryMs: number;      // Between backfill requests for the same reading
+  maxRequests: number;  // Then the reading is counted as lost
+  maxTracked: number;   // Readings before the last maxTracked of a jump are counted as lost (0: no buffer)
+}
+
+interface MissingReading {
+  detectedAt: number;
+  requests: number;
+  lastRequestAt: number;
+}
+
+interface DeviceSequence {
+  highestSeq: number;
+  epoch: number;                        // First sequence number since the node's last power-on
+  missing: Map<number, MissingReading>;
+  received: number;
+  backfilled: number;
+  lost: number;
+  lastSeen: number;
+}
+
+export class GapTracker {
+  private devices = new Map<string, DeviceSequence>();
+
+  constructor(private options: GapTrackerOptions) {}
+
+  // Live reading (gateway message) or history entry
+  record(deviceId: string, seq: number, epoch?: number, backfill = false, now = Date.now()): void {
+    let device = this.devices.get(deviceId);
+    if (!device) {
+      device = {
+        highestSeq: seq,
+        epoch: epoch ?? 0,
+        missing: new Map(),
+        received: 1,
+        backfilled: 0,
+        lost: 0,
+        lastSeen: now
+      };
+      this.devices.set(deviceId, device);
+      return;
+    }
+    device.lastSeen = now;
+
+    if (epoch !== undefined && epoch > device.epoch) {
+      // The node lost power: readings it still had went with its RTC memory
+      device.epoch = epoch;
+      for (const missingSeq of Array.from(device.missing.keys())) {
+        if (missingSeq < epoch) {
+          device.missing.delete(missingSeq);
+          device.lost++;
+        }
+      }
+    }
+
+    if (seq > device.highestSeq) {
+      // Numbers between the old highest and a new epoch were never used;
+      // only the last maxTracked can still be in the node's buffer
+      const gapStart = Math.max(device.highestSeq + 1, device.epoch);
+      const first = Math.max(gapStart, seq - this.options.maxTracked);
+      device.lost += first - gapStart;
+      for (let missingSeq = first; missingSeq < seq; missingSeq++) {
+        device.missing.set(missingSeq, { detectedAt: now, requests: 0, lastRequestAt: 0 });
+      }
+      device.highestSeq = seq;
+    } else if (device.missing.delete(seq)) {
+      if (backfill) {
+        device.backfilled++;
+      }
+    } else {
+      return; // Duplicate
+    }
+    device.received++;
+  }
+
+  // Backfill reply: anything requested below oldestSeq is no longer kept by the node
+  closeBackfill(deviceId: string, from: number, to: number, oldestSeq: number): void {
+    const device = this.devices.get(deviceId);
+    if (!device) {
+      return;
+    }
+    for (let missingSeq = from; missingSeq <= to && missingSeq < oldestSeq; missingSeq++) {
+      if (device.missing.delete(missingSeq)) {
+        device.lost++;
+      }
+    }
+  }
+
+  // Backfill requests that are due, one per contiguous range
+  due(now = Date.now()): BackfillRequest[] {
+    const requests: BackfillRequest[] = [];
+    this.devices.forEach((device, deviceId) => {
+      const ready: number[] = [];
+      device.missing.forEach((reading, missingSeq) => {
+        if (now - reading.detectedAt < this.options.graceMs) {
+          return;
+        }
+        if (reading.requests > 0 && now - reading.lastRequestAt < this.options.retryMs) {
+          return;
+        }
+        if (reading.requests >= this.options.maxRequests) {
+          device.missing.delete(missingSeq);
+          device.lost++;
+          return;
+        }
+        reading.requests++;
+        reading.lastRequestAt = now;
+        ready.push(missingSeq);
+      });
+
+      ready.sort((a, b) => a - b);
+      for (const missingSeq of ready) {
+        const last = requests[requests.length - 1];
+        if (last && last.device_id === deviceId && last.to === missingSeq - 1) {
+          last.to = missingSeq;
+        } else {
+          requests.push({ device_id: deviceId, from: missingSeq, to: missingSeq });
+        }
+      }
+    });
+    return requests;
+  }
+
+  summary(): Record<string, object> {
+    const result: Record<string, object> = {};
+    this.devices.forEach((device, deviceId) => {
+      result[deviceId] = {
+        highest_seq: device.highestSeq,
+        epoch: device.epoch,
+        missing: Array.from(device.missing.keys()).sort((a, b) => a - b),
+        received: device.received,
+        backfilled: device.backfilled,
+        lost: device.lost,
+        last_seen: new Date(device.lastSeen).toISOString()
+      };
+    });
+    return result;
+  }
+}
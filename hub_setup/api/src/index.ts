@@ -4,6 +4,9 @@ import helmet from 'helmet';
 import { createServer } from 'http';
 import { WebSocketServer } from 'ws';
 import mqtt from 'mqtt';
+import { GapTracker, BackfillRequest } from './gapTracker';
+import { decodeSeriesBlock } from './seriesCodec';
+import { ConfigMailbox, MAILBOX_TOPIC_PREFIX } from './configMailbox';
 
 const app = express();
 const server = createServer(app);
@@ -18,6 +21,30 @@ app.use(express.json());
 // MQTT Client
 const mqttClient = mqtt.connect(process.env.MQTT_BROKER || 'mqtt://localhost:1883');
 
+// Sequence gap tracking; nodes publish at QoS0 and serve backfill from their reading buffer
+const BACKFILL_CHECK_MS = 30000;
+const gapTracker = new GapTracker({
+  graceMs: Number(process.env.BACKFILL_GRACE_MS || 300000),
+  retryMs: Number(process.env.BACKFILL_RETRY_MS || 300000),
+  maxRequests: 3,
+  maxTracked: 48 // Node READING_BUFFER_CAPACITY
+});
+
+// ESP-NOW leaves relayed on poolio/relay/<device_id> keep no reading buffer,
+// so their gaps are counted as lost at once and never requested
+const RELAY_TOPIC_PREFIX = 'poolio/relay/';
+const leafGapTracker = new GapTracker({ graceMs: 0, retryMs: 0, maxRequests: 0, maxTracked: 0 });
+
+// Backfill commands are retained on poolio/config/<device_id>/cmd, so a node in
+// deep sleep reads them on its next wake; cleared once the node replies
+const COMMAND_TOPIC_SUFFIX = '/cmd';
+const HISTORY_TOPIC_PREFIX = 'poolio/history/';
+const pendingCommands = new Map<string, number>();
+
+// Remote configuration; retained mailboxes are read back from the broker on startup
+const MAILBOX_SETUP_DELAY_MS = 10000;
+const configMailbox = new ConfigMailbox();
+
 // WebSocket for real-time updates
 wss.on('connection', (ws) => {
   console.log('Client connected');
@@ -50,27 +77,164 @@ app.get('/api/sensors', (req, res) => {
   });
 });
 
+// Sequence gaps per device
+app.get('/api/gaps', (req, res) => {
+  res.json({ ...gapTracker.summary(), ...leafGapTracker.summary() });
+});
+
+// Desired and acknowledged configuration of a device
+app.get('/api/devices/:id/config', (req, res) => {
+  const status = configMailbox.status(req.params.id);
+  if (!status) {
+    return res.status(404).json({ error: 'Unknown device' });
+  }
+  res.json(status);
+});
+
+// Merge fields into the device's mailbox, e.g. {"sleep_duration": 600}
+app.put('/api/devices/:id/config', (req, res) => {
+  const fields = req.body || {};
+  const invalid = configMailbox.validate(fields);
+  if (invalid.length > 0 || Object.keys(fields).length === 0) {
+    return res.status(400).json({ error: 'Invalid fields', invalid });
+  }
+  const mailbox = configMailbox.update(req.params.id, fields);
+  mqttClient.publish(MAILBOX_TOPIC_PREFIX + req.params.id, JSON.stringify(mailbox), { qos: 1, retain: true });
+  res.json(mailbox);
+});
+
 // MQTT message handling
 mqttClient.on('connect', () => {
   console.log('Connected to MQTT broker');
-  mqttClient.subscribe('poolio/+/data');
+  mqttClient.subscribe(['poolio/+/data', 'poolio/gateway', 'poolio/history', HISTORY_TOPIC_PREFIX + '+',
+                        RELAY_TOPIC_PREFIX + '+', MAILBOX_TOPIC_PREFIX + '+', 'poolio/config_ack']);
 });
 
 mqttClient.on('message', (topic, message) => {
-  console.log(`Received: ${topic} - ${message.toString()}`);
+  // Series history blocks are binary; pass them on decoded
+  let data = message.toString();
+  if (topic.startsWith(HISTORY_TOPIC_PREFIX)) {
+    data = JSON.stringify(trackSeries(topic.slice(HISTORY_TOPIC_PREFIX.length), message));
+  }
+  console.log(`Received: ${topic} - ${data}`);
+  
+  if (topic === 'poolio/gateway' || topic === 'poolio/history' || topic.startsWith(RELAY_TOPIC_PREFIX)) {
+    trackSequence(topic, data);
+  }
+  if (topic.startsWith(MAILBOX_TOPIC_PREFIX) || topic === 'poolio/config_ack' || topic === 'poolio/gateway') {
+    trackConfig(topic, message.toString());
+  }
   
   // Broadcast to WebSocket clients
   wss.clients.forEach(client => {
     if (client.readyState === 1) { // WebSocket.OPEN
       client.send(JSON.stringify({
         topic,
-        data: message.toString(),
+        data,
         timestamp: new Date().toISOString()
       }));
     }
   });
 });
 
+function trackSequence(topic: string, message: string) {
+  let payload: any;
+  try {
+    payload = JSON.parse(message);
+  } catch {
+    return;
+  }
+  if (typeof payload.device_id !== 'string') {
+    return;
+  }
+
+  if (topic === 'poolio/gateway') {
+    if (typeof payload.seq === 'number') {
+      gapTracker.record(payload.device_id, payload.seq, payload.seq_epoch);
+    }
+    return;
+  }
+  if (topic.startsWith(RELAY_TOPIC_PREFIX)) {
+    if (typeof payload.seq === 'number') {
+      leafGapTracker.record(payload.device_id, payload.seq, payload.seq_epoch);
+    }
+    return;
+  }
+
+  // History: readings buffered while offline, or a backfill reply
+  const backfill = payload.backfill;
+  for (const reading of payload.readings || []) {
+    if (typeof reading.seq === 'number') {
+      gapTracker.record(payload.device_id, reading.seq, undefined, backfill !== undefined);
+    }
+  }
+  if (backfill && typeof backfill.oldest_seq === 'number') {
+    gapTracker.closeBackfill(payload.device_id, backfill.from, backfill.to, backfill.oldest_seq);
+  }
+  if (backfill && backfill.id === pendingCommands.get(payload.device_id)) {
+    pendingCommands.delete(payload.device_id);
+    mqttClient.publish(MAILBOX_TOPIC_PREFIX + payload.device_id + COMMAND_TOPIC_SUFFIX, '', { qos: 1, retain: true });
+  }
+}
+
+// History block published with HISTORY_FORMAT_SERIES on poolio/history/<device_id>
+function trackSeries(deviceId: string, message: Buffer) {
+  const block = decodeSeriesBlock(message);
+  if (!block) {
+    console.log(`Undecodable history block from ${deviceId}`);
+    return null;
+  }
+  for (const sample of block.samples) {
+    gapTracker.record(deviceId, sample.seq);
+  }
+  return { device_id: deviceId, node_time: block.now, readings: block.samples };
+}
+
+function trackConfig(topic: string, message: string) {
+  let payload: any;
+  try {
+    payload = JSON.parse(message);
+  } catch {
+    return;
+  }
+
+  if (topic.startsWith(MAILBOX_TOPIC_PREFIX)) {
+    configMailbox.restore(topic.slice(MAILBOX_TOPIC_PREFIX.length), payload);
+  } else if (typeof payload.device_id !== 'string') {
+    return;
+  } else if (topic === 'poolio/config_ack') {
+    configMailbox.acknowledge(payload);
+    console.log(`Config rev ${payload.rev} acknowledged by ${payload.device_id}`);
+  } else if (typeof payload.config_rev === 'number') {
+    configMailbox.reported(payload.device_id, payload.config_rev);
+  }
+}
+
+// Ask nodes again for readings that never arrived
+setInterval(() => {
+  const ranges = new Map<string, Omit<BackfillRequest, 'device_id'>[]>();
+  for (const { device_id, from, to } of gapTracker.due()) {
+    console.log(`Requesting backfill: ${device_id} ${from}-${to}`);
+    ranges.set(device_id, [...(ranges.get(device_id) || []), { from, to }]);
+  }
+  ranges.forEach((backfill, deviceId) => {
+    // A new id per command; the node skips one it already served
+    const id = Math.max(Math.floor(Date.now() / 1000), (pendingCommands.get(deviceId) || 0) + 1);
+    pendingCommands.set(deviceId, id);
+    mqttClient.publish(MAILBOX_TOPIC_PREFIX + deviceId + COMMAND_TOPIC_SUFFIX, JSON.stringify({ id, backfill }),
+                       { qos: 1, retain: true });
+  });
+}, BACKFILL_CHECK_MS);
+
+// Give every node a mailbox so it does not wait out its timeout on each wake
+setTimeout(() => {
+  setInterval(() => {
+    for (const { device_id, mailbox } of configMailbox.missing()) {
+      mqttClient.publish(MAILBOX_TOPIC_PREFIX + device_id, JSON.stringify(mailbox), { qos: 1, retain: true });
+    }
+  }, BACKFILL_CHECK_MS);
+}, MAILBOX_SETUP_DELAY_MS);
+
 server.listen(port, () => {
   console.log(`PoolIO API running on port ${port}`);
 });
\ No newline at end of file
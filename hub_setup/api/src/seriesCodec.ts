@@ -0,0 +1,162 @@
+// Decoder for the node's compressed history blocks on poolio/history/<device_id>.
+// Port of SeriesDecoder in esp32-pool-node/src/series_codec.cpp; see
+// series_codec.h there for the block layout.
+
+const SERIES_MAGIC = 'PS';
+const SERIES_VERSION = 2;
+const SERIES_HEADER_SIZE = 14;
+const SERIES_RUN_SIZE = 3;
+
+const SERIES_QUANTIZED = 0;
+const SERIES_XOR = 1;
+
+// Same bits as the node's BufferedReading::flags
+export const SERIES_HAS_TEMPERATURE = 0x01;
+export const SERIES_HAS_WATER_LEVEL = 0x02;
+export const SERIES_WATER_OK = 0x04;
+export const SERIES_HAS_BATTERY = 0x08;
+
+// temperature_f, battery_voltage, battery_percent
+const QUANTIZE_SCALE = [100, 1000, 1];
+const PAYLOAD_BITS = [0, 7, 9, 12, 32];
+
+export interface SeriesSample {
+  timestamp: number;
+  seq: number;
+  flags: number;
+  temperature_f?: number;
+  battery_voltage?: number;
+  battery_percent?: number;
+}
+
+export interface SeriesBlock {
+  now: number;      // Node clock when the block was finished
+  samples: SeriesSample[];
+}
+
+// Returns null if the block is truncated or not a series block
+export function decodeSeriesBlock(data: Buffer): SeriesBlock | null {
+  if (data.length < SERIES_HEADER_SIZE || data.toString('latin1', 0, 2) !== SERIES_MAGIC ||
+      data[2] !== SERIES_VERSION || data[3] > SERIES_XOR) {
+    return null;
+  }
+  const encoding = data[3];
+  const count = data.readUInt16LE(4);
+  const bitsLength = data.readUInt16LE(6);
+  const runCount = data.readUInt16LE(8);
+  if (SERIES_HEADER_SIZE + bitsLength + SERIES_RUN_SIZE * runCount > data.length) {
+    return null;
+  }
+
+  const bitEnd = bitsLength * 8;
+  let bitPosition = 0;
+  const readBits = (bits: number): number => {
+    if (bitPosition + bits > bitEnd) {
+      throw new RangeError('series bitstream truncated');
+    }
+    let value = 0;
+    while (bits > 0) {
+      const free = 8 - (bitPosition % 8);
+      const n = Math.min(bits, free);
+      const chunk = (data[SERIES_HEADER_SIZE + Math.floor(bitPosition / 8)] >> (free - n)) & ((1 << n) - 1);
+      value = value * 2 ** n + chunk;
+      bitPosition += n;
+      bits -= n;
+    }
+    return value;
+  };
+  const readInteger = (): number => {
+    let prefix = 0;
+    while (prefix < 4 && readBits(1)) {
+      prefix++;
+    }
+    const zigzag = prefix > 0 ? readBits(PAYLOAD_BITS[prefix]) : 0;
+    return zigzag % 2 ? -(zigzag + 1) / 2 : zigzag / 2;
+  };
+
+  const lastBits = [0, 0, 0];
+  const leading = [0, 0, 0];
+  const meaningful = [0, 0, 0];
+  const readXor = (channel: number): number => {
+    if (readBits(1)) {
+      if (readBits(1)) {
+        const header = readBits(10);
+        leading[channel] = header >> 5;
+        meaningful[channel] = (header & 0x1f) + 1;
+        if (leading[channel] + meaningful[channel] > 32) {
+          throw new RangeError('series xor window out of range');
+        }
+      } else if (meaningful[channel] === 0) {
+        throw new RangeError('series xor window missing');
+      }
+      const value = readBits(meaningful[channel]);
+      lastBits[channel] = (lastBits[channel] ^ (value << (32 - leading[channel] - meaningful[channel]))) >>> 0;
+    }
+    const float = Buffer.alloc(4);
+    float.writeUInt32LE(lastBits[channel]);
+    return float.readFloatLE(0);
+  };
+
+  const samples: SeriesSample[] = [];
+  let runOffset = SERIES_HEADER_SIZE + bitsLength;
+  let runsLeft = runCount;
+  let runFlags = 0;
+  let runLeft = 0;
+  let timestamp = 0;
+  let delta = 0;
+  let seq = 0;
+  try {
+    while (samples.length < count) {
+      if (runLeft === 0) {
+        if (runsLeft === 0) {
+          return null;
+        }
+        runFlags = data[runOffset];
+        runLeft = data.readUInt16LE(runOffset + 1);
+        runOffset += SERIES_RUN_SIZE;
+        runsLeft--;
+        if (runLeft === 0) {
+          return null;
+        }
+      }
+
+      if (samples.length === 0) {
+        timestamp = readBits(32);
+        seq = readBits(32);
+      } else {
+        delta += readInteger();
+        timestamp = (timestamp + delta) >>> 0;
+        seq = (seq + readInteger() + 1) >>> 0;
+      }
+      const sample: SeriesSample = { timestamp, seq, flags: runFlags };
+
+      const values: number[] = [];
+      for (let channel = 0; channel < QUANTIZE_SCALE.length; channel++) {
+        const present = channel === 0 ? (runFlags & SERIES_HAS_TEMPERATURE) !== 0
+                                       : (runFlags & SERIES_HAS_BATTERY) !== 0;
+        if (!present) {
+          continue;
+        }
+        if (encoding === SERIES_QUANTIZED) {
+          lastBits[channel] = (lastBits[channel] + readInteger()) >>> 0;
+          values[channel] = (lastBits[channel] | 0) / QUANTIZE_SCALE[channel];
+        } else {
+          values[channel] = readXor(channel);
+        }
+      }
+      if (values[0] !== undefined) {
+        sample.temperature_f = values[0];
+      }
+      if (values[1] !== undefined) {
+        sample.battery_voltage = values[1];
+        sample.battery_percent = values[2];
+      }
+
+      samples.push(sample);
+      runLeft--;
+    }
+  } catch {
+    return null;
+  }
+  return { now: data.readUInt32LE(10), samples };
+}